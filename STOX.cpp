@@ -4,12 +4,39 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <memory>
 #include <queue>
+#include <deque>
 #include <iomanip>
 #include <ctime>
 #include <algorithm>
 #include <stdexcept>
 #include <limits>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <filesystem>
+#include <charconv>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#if defined(__x86_64__)||defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 using namespace std;
 
@@ -56,6 +83,51 @@ public:
     FileOperationException(const string& msg) : runtime_error("File operation failed: " + msg) {}
 };
 
+class InvalidProductIdException : public runtime_error {
+public:
+    InvalidProductIdException() : runtime_error("Product ID out of supported range!") {}
+};
+
+class EmptyTransactionException : public runtime_error {
+public:
+    EmptyTransactionException() : runtime_error("No item could be sold, nothing was charged!") {}
+};
+
+/* fixed-size chunks never move once allocated, so element addresses stay valid while the array grows;
+   readers may index concurrently with ensure(), growth itself must be serialised by the owner */
+template<typename T, size_t CHUNK_BITS = 14>
+class ChunkedArray {
+public:
+    static const size_t CHUNK_SIZE = (size_t)1 << CHUNK_BITS;
+    static const size_t MAX_CHUNKS = 4096;
+    static const size_t MAX_SIZE = CHUNK_SIZE * MAX_CHUNKS;
+private:
+    atomic<T*> chunks[MAX_CHUNKS];
+    size_t chunkCount;
+public:
+    ChunkedArray() : chunkCount(0) {}
+    ChunkedArray(const ChunkedArray&) = delete;
+    ChunkedArray& operator=(const ChunkedArray&) = delete;
+    ~ChunkedArray(){
+        for(size_t i=0;i<chunkCount;i++) delete[] chunks[i].load();
+    }
+    size_t capacity() const { return chunkCount*CHUNK_SIZE; }
+    void ensure(size_t n){
+        if(n>MAX_SIZE) throw length_error("ChunkedArray capacity exceeded");
+        while(capacity()<n) chunks[chunkCount++].store(new T[CHUNK_SIZE],memory_order_release);
+    }
+    void ensure(size_t n, const T& fill){
+        if(n>MAX_SIZE) throw length_error("ChunkedArray capacity exceeded");
+        while(capacity()<n){
+            T* chunk=new T[CHUNK_SIZE];
+            for(size_t i=0;i<CHUNK_SIZE;i++) chunk[i]=fill;
+            chunks[chunkCount++].store(chunk,memory_order_release);
+        }
+    }
+    T& operator[](size_t i){ return chunks[i>>CHUNK_BITS].load(memory_order_acquire)[i&(CHUNK_SIZE-1)]; }
+    const T& operator[](size_t i) const { return chunks[i>>CHUNK_BITS].load(memory_order_acquire)[i&(CHUNK_SIZE-1)]; }
+};
+
 class Person {
 protected:
     string name;
@@ -70,6 +142,7 @@ public:
     }
     int getId() const { return id; }
     string getName() const { return name; }
+    string getPhone() const { return phone; }
 };
 
 class Employee : public Person {
@@ -99,6 +172,7 @@ public:
     Manager(string n = "", int i = 0, string p = "", double s = 0, double b = 0)
         : Employee(n, i, p, s, "Manager"), bonus(b) {}
     double calculateSalary() const { return salary + bonus; }
+    double getBonus() const { return bonus; }
     void display() const {
         Employee::display();
         cout << CYAN << "Bonus: " << RESET << YELLOW << "$" << bonus << RESET
@@ -108,327 +182,4692 @@ public:
 
 class Cashier : public Employee {
 private:
-    int transactionCount;
+    atomic<int> transactionCount;
 public:
     Cashier(string n = "", int i = 0, string p = "", double s = 0)
         : Employee(n, i, p, s, "Cashier"), transactionCount(0) {}
-    double calculateSalary() const { return salary + (transactionCount * 0.5); }
-    void incrementTransactions() { transactionCount++; }
+    double calculateSalary() const { return salary + (transactionCount.load(memory_order_relaxed) * 0.5); }
+    void incrementTransactions() { transactionCount.fetch_add(1,memory_order_relaxed); }
+    int getTransactionCount() const { return transactionCount.load(memory_order_relaxed); }
+    void setTransactionCount(int n) { transactionCount.store(n,memory_order_relaxed); }
     void display() const {
         Employee::display();
-        cout << CYAN << "Transactions: " << RESET << transactionCount 
+        cout << CYAN << "Transactions: " << RESET << transactionCount.load() 
              << CYAN << ", Total Salary: " << RESET << BRIGHT_GREEN << "$" << calculateSalary() << RESET << endl;
     }
 };
 
+uint32_t fnv1a(const char* data,size_t n,uint32_t hash=2166136261u){
+    for(size_t i=0;i<n;i++){ hash^=(unsigned char)data[i]; hash*=16777619u; }
+    return hash;
+}
+
+/* quotes a CSV field when it contains a separator, quote or line break */
+string csvField(const string& value){
+    if(value.find_first_of(",\"\r\n")==string::npos) return value;
+    string quoted="\"";
+    for(char c:value){
+        if(c=='"') quoted+='"';
+        quoted+=c;
+    }
+    return quoted+"\"";
+}
+
+/* money is kept in integer cents; doubles only appear at input and display */
+typedef int64_t Cents;
+inline Cents toCents(double amount){ return llround(amount*100); }
+string formatCents(Cents amount){
+    char text[32];
+    char* p=text;
+    if(amount<0){ *p++='-'; amount=-amount; }
+    p=to_chars(p,text+sizeof(text)-3,amount/100).ptr;
+    *p++='.';
+    *p++=(char)('0'+amount%100/10);
+    *p++=(char)('0'+amount%10);
+    return string(text,p);
+}
+
+class InvalidBarcodeException : public runtime_error {
+public:
+    InvalidBarcodeException() : runtime_error("Character cannot be encoded in Code39!") {}
+};
+
+/* id-indexed staff directory. Pay inputs are mirrored into struct-of-arrays columns so a payroll
+   run is one straight pass over contiguous doubles instead of a virtual call per employee. */
+class EmployeeRegistry {
+public:
+    static const size_t COLUMN_BITS = 12;
+    struct PayrollSummary {
+        size_t headcount;
+        double baseTotal, bonusTotal, commissionTotal, grandTotal;
+        vector<double> totals; /* per employee, in registration order */
+    };
+private:
+    enum Kind : uint8_t { MANAGER = 1, CASHIER = 2 };
+    vector<Employee*> staff;
+    ChunkedArray<int> slotById;
+    int maxId;
+    ChunkedArray<uint8_t,COLUMN_BITS> kind;
+    ChunkedArray<double,COLUMN_BITS> baseSalary, bonus, perTransaction;
+    ChunkedArray<atomic<int>,COLUMN_BITS> transactionCount;
+    int slotOf(int id) const {
+        if(id<0||id>maxId) return -1;
+        return slotById[id];
+    }
+public:
+    EmployeeRegistry() : maxId(-1) {}
+    EmployeeRegistry(const EmployeeRegistry&) = delete;
+    EmployeeRegistry& operator=(const EmployeeRegistry&) = delete;
+    ~EmployeeRegistry(){ for(auto e:staff) delete e; }
+    /* takes ownership; hiring happens from the menu, never while lanes are checking out */
+    void add(Employee* e){
+        int id=e->getId();
+        if(id<0||(size_t)id>=ChunkedArray<int>::MAX_SIZE){ delete e; throw invalid_argument("Employee ID out of supported range!"); }
+        size_t slot=staff.size();
+        slotById.ensure((size_t)id+1,-1);
+        kind.ensure(slot+1); baseSalary.ensure(slot+1); bonus.ensure(slot+1);
+        perTransaction.ensure(slot+1); transactionCount.ensure(slot+1);
+        Manager* m=dynamic_cast<Manager*>(e);
+        Cashier* c=dynamic_cast<Cashier*>(e);
+        kind[slot]=m?MANAGER:CASHIER;
+        baseSalary[slot]=e->getSalary();
+        bonus[slot]=m?m->getBonus():0;
+        perTransaction[slot]=c?0.5:0;
+        transactionCount[slot].store(c?c->getTransactionCount():0,memory_order_relaxed);
+        staff.push_back(e);
+        slotById[id]=(int)slot;
+        if(id>maxId) maxId=id;
+    }
+    Employee* find(int id) const {
+        int slot=slotOf(id);
+        return slot<0?nullptr:staff[slot];
+    }
+    Cashier* findCashier(int id) const {
+        int slot=slotOf(id);
+        return (slot<0||kind[slot]!=CASHIER)?nullptr:static_cast<Cashier*>(staff[slot]);
+    }
+    /* counts a committed sale toward the cashier's commission */
+    void recordSale(int cashierId){
+        int slot=slotOf(cashierId);
+        if(slot<0||kind[slot]!=CASHIER) return;
+        static_cast<Cashier*>(staff[slot])->incrementTransactions();
+        transactionCount[slot].fetch_add(1,memory_order_relaxed);
+    }
+    void setTransactionCount(int cashierId,int n){
+        Cashier* c=findCashier(cashierId);
+        if(!c) return;
+        c->setTransactionCount(n);
+        transactionCount[slotOf(cashierId)].store(n,memory_order_relaxed);
+    }
+    size_t size() const { return staff.size(); }
+    bool empty() const { return staff.empty(); }
+    const vector<Employee*>& all() const { return staff; }
+    /* same formulas as Manager/Cashier::calculateSalary: base + bonus + transactions * rate,
+       where the unused term is exactly zero, so totals match the virtual calls bit for bit */
+    PayrollSummary runPayroll() const {
+        PayrollSummary summary;
+        size_t n=staff.size();
+        summary.headcount=n;
+        summary.totals.resize(n);
+        summary.baseTotal=summary.bonusTotal=summary.commissionTotal=summary.grandTotal=0;
+        const size_t CHUNK=(size_t)1<<COLUMN_BITS;
+        vector<double> counts(CHUNK);
+        for(size_t start=0;start<n;start+=CHUNK){
+            size_t len=min(CHUNK,n-start);
+            const double* base=&baseSalary[start];
+            const double* extra=&bonus[start];
+            const double* rate=&perTransaction[start];
+            for(size_t i=0;i<len;i++) counts[i]=transactionCount[start+i].load(memory_order_relaxed);
+            double* out=&summary.totals[start];
+            const double* cnt=counts.data();
+            double baseSum=0, bonusSum=0, commissionSum=0, totalSum=0;
+            for(size_t i=0;i<len;i++){
+                double commission=cnt[i]*rate[i];
+                double total=base[i]+extra[i]+commission;
+                out[i]=total;
+                baseSum+=base[i]; bonusSum+=extra[i]; commissionSum+=commission; totalSum+=total;
+            }
+            summary.baseTotal+=baseSum; summary.bonusTotal+=bonusSum;
+            summary.commissionTotal+=commissionSum; summary.grandTotal+=totalSum;
+        }
+        return summary;
+    }
+};
+
+/* Code39 patterns are resolved at compile time into 9-bit masks (bit set = wide element) */
+constexpr const char* CODE39_SYMBOLS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-. *";
+constexpr const char* CODE39_PATTERNS[44] = {
+    "nnnwwnwnn","wnnwnnnnw","nnwwnnnnw","wnwwnnnnn","nnnwwnnnw","wnnwwnnnn","nnwwwnnnn",
+    "nnnwnnwnw","wnnwnnwnn","nnwwnnwnn","wnnnnwnnw","nnwnnwnnw","wnwnnwnnn","nnnnwwnnw",
+    "wnnnwwnnn","nnwnwwnnn","nnnnnwwnw","wnnnnwwnn","nnwnnwwnn","nnnnwwwnn","wnnnnnnww",
+    "nnwnnnnww","wnwnnnnwn","nnnnwnnww","wnnnwnnwn","nnwnwnnwn","nnnnnnwww","wnnnnnwwn",
+    "nnwnnnwwn","nnnnwnwwn","wwnnnnnnw","nwwnnnnnw","wwwnnnnnn","nwnnwnnnw","wwnnwnnnn",
+    "nwwnwnnnn","nwnnnnwnw","wwnnnnwnn","nwwnnnwnn","nwnnwnwnn"
+};
+struct Code39Table { uint16_t wideMask[128]; char symbolByMask[512]; };
+constexpr Code39Table buildCode39Table(){
+    Code39Table t{};
+    for(int c=0;c<128;c++) t.wideMask[c]=0xFFFF;
+    for(int i=0;CODE39_SYMBOLS[i];i++){
+        uint16_t mask=0;
+        for(int j=0;j<9;j++) if(CODE39_PATTERNS[i][j]=='w') mask|=(uint16_t)(1<<j);
+        t.wideMask[(int)CODE39_SYMBOLS[i]]=mask;
+        t.symbolByMask[mask]=CODE39_SYMBOLS[i];
+    }
+    return t;
+}
+constexpr Code39Table CODE39_TABLE = buildCode39Table();
+
+class Code39 {
+public:
+    static const int NARROW = 1, WIDE = 3; /* barcode line width macros*/
+    static const int HEIGHT = 50;
+    static uint16_t pattern(char c){
+        uint16_t mask=((unsigned char)c<128)?CODE39_TABLE.wideMask[(int)c]:0xFFFF;
+        if(mask==0xFFFF) throw InvalidBarcodeException();
+        return mask;
+    }
+    static int width(const string& text){
+        int total=0;
+        for(char c:text){
+            uint16_t mask=pattern(c);
+            for(int j=0;j<9;j++) total+=(mask>>j&1)?WIDE:NARROW;
+            total+=NARROW;
+        }
+        return total;
+    }
+    /* renders one pixel row as 0/1 modules; every row of the label is identical */
+    static vector<uint8_t> renderRow(const string& text){
+        vector<uint8_t> row;
+        row.reserve(width(text));
+        for(char c:text){
+            uint16_t mask=pattern(c);
+            for(int j=0;j<9;j++) row.insert(row.end(),(mask>>j&1)?WIDE:NARROW,(uint8_t)(j%2==0));
+            row.insert(row.end(),NARROW,(uint8_t)0);
+        }
+        return row;
+    }
+    /* complete PBM image in memory: packed P4 or the ascii P1 layout written before */
+    static string render(const string& text,bool ascii=false){
+        vector<uint8_t> row=renderRow(text);
+        string header=(ascii?"P1\n":"P4\n")+to_string(row.size())+" "+to_string(HEIGHT)+"\n";
+        string line;
+        if(ascii){
+            line.reserve(row.size()*2+1);
+            for(uint8_t bit:row){ line+=(char)('0'+bit); line+=' '; }
+            line+='\n';
+        } else {
+            line.assign((row.size()+7)/8,'\0');
+            for(size_t i=0;i<row.size();i++) if(row[i]) line[i>>3]|=(char)(0x80>>(i&7));
+        }
+        string image;
+        image.reserve(header.size()+line.size()*HEIGHT);
+        image+=header;
+        for(int r=0;r<HEIGHT;r++) image+=line;
+        return image;
+    }
+    /* bar/space run widths of one packed row (MSB first), from the first bar to the row's end. The
+       row is walked 64 pixels per step: the set bits of pixel^previous pixel are the run edges */
+    static void runLengths(const uint8_t* row,size_t width,vector<uint32_t>& runs){
+        runs.clear();
+        size_t bytes=(width+7)/8, last=0;
+        bool started=false;
+        uint64_t previous=0;
+        for(size_t base=0;base<width;base+=64){
+            uint64_t word=0;
+            size_t take=min<size_t>(8,bytes-base/8);
+            for(size_t k=0;k<take;k++) word|=(uint64_t)row[base/8+k]<<(56-8*k);
+            uint64_t edges=word^(word>>1|previous<<63);
+            previous=word&1;
+            while(edges){
+                int lead=__builtin_clzll(edges);
+                edges&=~(1ull<<(63-lead));
+                size_t pos=base+(size_t)lead;
+                if(pos>=width) break;
+                if(started) runs.push_back((uint32_t)(pos-last));
+                started=true;
+                last=pos;
+            }
+        }
+        if(started) runs.push_back((uint32_t)(width-last));
+    }
+    /* Code39 text between the start and stop '*' of a run list that begins with a bar. Widths are
+       classified per character against the midpoint of its narrowest and widest element, so any
+       module size decodes; every character must have exactly three wide elements */
+    static string decodeRuns(const vector<uint32_t>& runs){
+        string text;
+        bool open=false;
+        for(size_t i=0;i+9<=runs.size();i+=10){
+            uint32_t low=runs[i], high=runs[i];
+            for(size_t j=1;j<9;j++){ low=min(low,runs[i+j]); high=max(high,runs[i+j]); }
+            if(high*2<low*3) throw InvalidBarcodeException();
+            uint16_t mask=0;
+            for(size_t j=0;j<9;j++) if(runs[i+j]*2>low+high) mask|=(uint16_t)(1<<j);
+            char c=CODE39_TABLE.symbolByMask[mask];
+            if(!c) throw InvalidBarcodeException();
+            if(c=='*'){
+                if(open) return text;
+                open=true;
+            } else if(open) text+=c;
+            else throw InvalidBarcodeException();
+        }
+        throw InvalidBarcodeException();
+    }
+    /* decodes a label written by render(): P1 or P4, comments allowed in the header. Only the
+       middle row is read since every row carries the same bars */
+    static string decodePbm(const char* data,size_t size,vector<uint32_t>& runs,vector<uint8_t>& row){
+        const char* p=data;
+        const char* end=data+size;
+        auto skipSpace=[&](){
+            while(p<end&&(isspace((unsigned char)*p)||*p=='#')){
+                if(*p=='#') while(p<end&&*p!='\n') p++;
+                else p++;
+            }
+        };
+        auto number=[&](){
+            skipSpace();
+            size_t value=0;
+            auto res=from_chars(p,end,value);
+            if(res.ec!=errc()||value==0||value>(1u<<24)) throw InvalidBarcodeException();
+            p=res.ptr;
+            return value;
+        };
+        if(size<3||data[0]!='P'||(data[1]!='1'&&data[1]!='4')) throw InvalidBarcodeException();
+        bool ascii=data[1]=='1';
+        p+=2;
+        size_t width=number(), height=number(), stride=(width+7)/8, middle=height/2;
+        if(ascii){
+            row.assign(stride,0);
+            size_t pixel=0, wanted=middle*width;
+            for(;p<end&&pixel<wanted+width;p++){
+                if(*p!='0'&&*p!='1'){
+                    if(*p=='#') while(p<end&&*p!='\n') p++;
+                    continue;
+                }
+                if(pixel>=wanted&&*p=='1') row[(pixel-wanted)>>3]|=(uint8_t)(0x80>>((pixel-wanted)&7));
+                pixel++;
+            }
+            if(pixel<wanted+width) throw InvalidBarcodeException();
+            runLengths(row.data(),width,runs);
+        } else {
+            if(p>=end||!isspace((unsigned char)*p)) throw InvalidBarcodeException();
+            p++;
+            if((size_t)(end-p)<stride*(middle+1)) throw InvalidBarcodeException();
+            runLengths((const uint8_t*)p+stride*middle,width,runs);
+        }
+        return decodeRuns(runs);
+    }
+    static string decodePbm(const string& image){
+        vector<uint32_t> runs;
+        vector<uint8_t> row;
+        return decodePbm(image.data(),image.size(),runs,row);
+    }
+};
+
+/* Product text kept outside the records. Names are appended to one shared arena and referenced by
+   offset and length; categories are interned once and referenced by a 16-bit id. Both only grow,
+   so readers need no lock. A renamed product leaves its old bytes behind until the next restart. */
+class ProductText {
+public:
+    static const size_t BLOCK_BITS = 20;
+    static const size_t SLICE = 65536; /* handed to one thread at a time; a block holds 16 */
+    static const size_t MAX_NAME = SLICE-1;
+    static const size_t MAX_CATEGORIES = 65536;
+private:
+    ChunkedArray<char,BLOCK_BITS> arena;
+    uint64_t arenaTail;
+    ChunkedArray<string,10> categoryNames;
+    unordered_map<string,uint16_t> categoryIds;
+    mutex lock;
+    ProductText() : arenaTail(0) { category(""); }
+public:
+    static ProductText& shared(){
+        static ProductText text;
+        return text;
+    }
+    /* returns the arena offset. Each thread fills its own slice, so parallel loaders only take
+       the lock once per 64 KB of names; a name never straddles two slices */
+    uint32_t appendName(string_view name){
+        if(name.size()>MAX_NAME) throw runtime_error("Product name is too long");
+        if(name.empty()) return 0;
+        thread_local uint64_t next=0, end=0;
+        if(next+name.size()>end){
+            lock_guard<mutex> guard(lock);
+            if(arenaTail+SLICE>(uint64_t)UINT32_MAX+1) throw length_error("Product name arena is full");
+            next=arenaTail;
+            end=arenaTail+=SLICE;
+            arena.ensure(end);
+        }
+        memcpy(&arena[next],name.data(),name.size());
+        uint32_t offset=(uint32_t)next;
+        next+=name.size();
+        return offset;
+    }
+    string_view name(uint32_t offset,uint16_t length) const {
+        return length?string_view(&arena[offset],length):string_view();
+    }
+    uint16_t category(const string& name){
+        lock_guard<mutex> guard(lock);
+        auto it=categoryIds.find(name);
+        if(it!=categoryIds.end()) return it->second;
+        if(categoryIds.size()>=MAX_CATEGORIES) throw length_error("Too many product categories");
+        uint16_t id=(uint16_t)categoryIds.size();
+        categoryNames.ensure((size_t)id+1);
+        categoryNames[id]=name;
+        categoryIds.emplace(name,id);
+        return id;
+    }
+    const string& categoryName(uint16_t id) const { return categoryNames[id]; }
+    /* -1 when no product was ever filed under name */
+    int findCategory(const string& name){
+        lock_guard<mutex> guard(lock);
+        auto it=categoryIds.find(name);
+        return it==categoryIds.end()?-1:it->second;
+    }
+    size_t categoryCount(){
+        lock_guard<mutex> guard(lock);
+        return categoryIds.size();
+    }
+    size_t arenaBytes(){
+        lock_guard<mutex> guard(lock);
+        return arenaTail;
+    }
+};
+
+/* Multi-version stock so reports see one instant without stopping the tills. Every stock word
+   carries the epoch of its last write. A snapshot advances the epoch to its boundary B; the first
+   write at epoch >= B to a word older than B saves the old level in the snapshot's side table, and
+   baskets still running in an older epoch add their deltas to both. Saved levels are keyed by the
+   stock word itself, since stores in a chain share product ids. Readers take the live level
+   when the word predates B and the saved one otherwise, so nobody waits on anybody's lock. */
+class StockVersions {
+public:
+    static uint64_t pack(int stock,uint32_t epoch){ return (uint64_t)epoch<<32|(uint32_t)stock; }
+    static int stockOf(uint64_t word){ return (int32_t)(uint32_t)word; }
+    static uint32_t epochOf(uint64_t word){ return (uint32_t)(word>>32); }
+    /* stock levels as of the boundary for the records written since. Buckets are indexed by product
+       id in lazily allocated chunks; each holds an insert-only list with one entry per record of that
+       id (one per store). One Version is kept for reuse and only what a snapshot touched is freed */
+    struct Version {
+        static const size_t CHUNK_BITS=12, CHUNK=(size_t)1<<CHUNK_BITS;
+        static const size_t CHUNKS=ChunkedArray<int>::MAX_SIZE>>CHUNK_BITS;
+        static const int64_t VALID=(int64_t)1<<40;
+        struct Saved {
+            const atomic<uint64_t>* word;
+            atomic<int64_t> value;
+            Saved* next;
+        };
+        uint32_t boundary;
+        unique_ptr<atomic<atomic<Saved*>*>[]> chunks;
+        unique_ptr<uint32_t[]> touched;
+        atomic<uint32_t> touchedCount;
+        Version() : boundary(0), chunks(new atomic<atomic<Saved*>*>[CHUNKS]), touched(new uint32_t[CHUNKS]), touchedCount(0) {
+            for(size_t i=0;i<CHUNKS;i++) chunks[i].store(nullptr,memory_order_relaxed);
+        }
+        ~Version(){ clear(); }
+        atomic<Saved*>& bucket(int id){
+            atomic<atomic<Saved*>*>& slot=chunks[(size_t)id>>CHUNK_BITS];
+            atomic<Saved*>* chunk=slot.load(memory_order_acquire);
+            if(!chunk){
+                atomic<Saved*>* fresh=new atomic<Saved*>[CHUNK];
+                for(size_t i=0;i<CHUNK;i++) fresh[i].store(nullptr,memory_order_relaxed);
+                if(slot.compare_exchange_strong(chunk,fresh,memory_order_acq_rel,memory_order_acquire)){
+                    chunk=fresh;
+                    touched[touchedCount.fetch_add(1,memory_order_relaxed)]=(uint32_t)((size_t)id>>CHUNK_BITS);
+                }
+                else delete[] fresh;
+            }
+            return chunk[(size_t)id&(CHUNK-1)];
+        }
+        /* finds or pushes the entry of one stock word; a failed push rescans from the new head, so
+           racing writers and readers of the same record always end up sharing one entry */
+        atomic<int64_t>& entry(int id,const atomic<uint64_t>& word){
+            atomic<Saved*>& head=bucket(id);
+            Saved* first=head.load(memory_order_acquire);
+            Saved* fresh=nullptr;
+            while(true){
+                for(Saved* s=first;s;s=s->next)
+                    if(s->word==&word){ delete fresh; return s->value; }
+                if(!fresh){
+                    fresh=new Saved();
+                    fresh->word=&word;
+                    fresh->value.store(0,memory_order_relaxed);
+                }
+                fresh->next=first;
+                if(head.compare_exchange_weak(first,fresh,memory_order_acq_rel,memory_order_acquire)) return fresh->value;
+            }
+        }
+        /* only once nobody can reach it any more */
+        void clear(){
+            uint32_t n=touchedCount.exchange(0,memory_order_relaxed);
+            for(uint32_t i=0;i<n;i++){
+                atomic<Saved*>* chunk=chunks[touched[i]].exchange(nullptr,memory_order_relaxed);
+                for(size_t b=0;b<CHUNK;b++)
+                    for(Saved* s=chunk[b].load(memory_order_relaxed);s;){
+                        Saved* next=s->next;
+                        delete s;
+                        s=next;
+                    }
+                delete[] chunk;
+            }
+        }
+    };
+private:
+    struct Slot {
+        atomic<uint32_t> epoch; /* 0 while the thread is outside any write */
+        uint32_t depth;         /* owner thread only */
+        Slot() : epoch(0), depth(0) {}
+    };
+    /* slots are recycled but never freed, so a snapshot can wait on them without the lock */
+    struct Registry {
+        mutex lock;
+        vector<Slot*> slots, spare;
+    };
+    struct Handle {
+        Slot* slot;
+        Handle(){
+            Registry& r=shared().registry;
+            lock_guard<mutex> guard(r.lock);
+            if(r.spare.empty()){ slot=new Slot(); r.slots.push_back(slot); }
+            else { slot=r.spare.back(); r.spare.pop_back(); }
+        }
+        ~Handle(){
+            Registry& r=shared().registry;
+            lock_guard<mutex> guard(r.lock);
+            r.spare.push_back(slot);
+        }
+    };
+    static Slot& local(){
+        thread_local Handle h;
+        return *h.slot;
+    }
+    Registry registry;
+    atomic<uint32_t> clock;
+    atomic<Version*> active;
+    mutex snapshotLock;
+    unique_ptr<Version> version; /* created by the first snapshot */
+    StockVersions() : clock(1), active(nullptr) {}
+    /* until every thread is idle or writing at epoch >= bound */
+    void waitForEpochsBefore(uint32_t bound){
+        vector<Slot*> slots;
+        {
+            lock_guard<mutex> guard(registry.lock);
+            slots=registry.slots;
+        }
+        for(Slot* s:slots){
+            uint32_t e;
+            while((e=s->epoch.load(memory_order_seq_cst))!=0&&e<bound) this_thread::yield();
+        }
+    }
+public:
+    static StockVersions& shared(){
+        static StockVersions v;
+        return v;
+    }
+    /* pins the calling thread to the current epoch; a checkout holds one across the whole basket so a
+       snapshot sees all of its lines or none. Nested scopes join the outer one */
+    class Scope {
+    private:
+        Slot& slot;
+    public:
+        Scope() : slot(local()) {
+            if(slot.depth++) return;
+            atomic<uint32_t>& clock=shared().clock;
+            uint32_t e=clock.load(memory_order_seq_cst);
+            while(true){ /* publish, then make sure no snapshot moved the clock in between */
+                slot.epoch.store(e,memory_order_seq_cst);
+                uint32_t now=clock.load(memory_order_seq_cst);
+                if(now==e) break;
+                e=now;
+            }
+        }
+        ~Scope(){ if(--slot.depth==0) slot.epoch.store(0,memory_order_release); }
+        Scope(const Scope&)=delete;
+        Scope& operator=(const Scope&)=delete;
+        uint32_t epoch() const { return slot.epoch.load(memory_order_relaxed); }
+    };
+    /* every stock write goes through here; returns the level it left behind */
+    int apply(atomic<uint64_t>& word,int id,int delta,bool floorAtZero){
+        Scope scope;
+        uint32_t epoch=scope.epoch();
+        uint64_t current=word.load(memory_order_acquire);
+        while(true){
+            int stock=stockOf(current);
+            uint32_t last=epochOf(current);
+            if(floorAtZero&&stock+delta<0) throw InsufficientStockException();
+            Version* v=active.load(memory_order_seq_cst);
+            if(word.compare_exchange_weak(current,pack(stock+delta,max(last,epoch)),memory_order_acq_rel,memory_order_acquire)){
+                if(v&&epoch>=v->boundary&&last<v->boundary) v->entry(id,word).fetch_add(Version::VALID+stock,memory_order_release);
+                else if(v&&epoch<v->boundary&&last>=v->boundary) v->entry(id,word).fetch_add(delta,memory_order_release);
+                return stock+delta;
+            }
+        }
+    }
+    /* one snapshot at a time; opening waits for baskets that started before it to finish */
+    Version* open(){
+        snapshotLock.lock();
+        uint32_t boundary=clock.load(memory_order_seq_cst)+1;
+        if(!version) version.reset(new Version());
+        Version* v=version.get();
+        v->boundary=boundary;
+        active.store(v,memory_order_seq_cst);
+        clock.store(boundary,memory_order_seq_cst);
+        waitForEpochsBefore(boundary);
+        return v;
+    }
+    void close(Version* v){
+        active.store(nullptr,memory_order_seq_cst);
+        uint32_t next=clock.fetch_add(1,memory_order_seq_cst)+1;
+        waitForEpochsBefore(next); /* nobody can still be holding v */
+        v->clear();
+        snapshotLock.unlock();
+    }
+    static int stockAt(Version& v,const atomic<uint64_t>& cell,int id){
+        uint64_t word=cell.load(memory_order_acquire);
+        if(epochOf(word)<v.boundary) return stockOf(word);
+        atomic<int64_t>& saved=v.entry(id,cell);
+        int64_t value;
+        while((value=saved.load(memory_order_acquire))<Version::VALID/2) this_thread::yield(); /* writer between its two steps */
+        return (int)(value-Version::VALID);
+    }
+};
+
+/* 24-byte record: the barcode is always PRD<id> and is derived when asked for. Stock shares a word
+   with the epoch of its last write (see StockVersions) */
 class Product {
 private:
-    int productId;
-    string name;
-    double price;
-    int stock;
-    string category;
-    string barcode;
-    map<char, string> getCode39Map() {
-        map<char, string> code39;
-        code39['0']="nnnwwnwnn"; code39['1']="wnnwnnnnw"; code39['2']="nnwwnnnnw";
-        code39['3']="wnwwnnnnn"; code39['4']="nnnwwnnnw"; code39['5']="wnnwwnnnn";
-        code39['6']="nnwwwnnnn"; code39['7']="nnnwnnwnw"; code39['8']="wnnwnnwnn";
-        code39['9']="nnwwnnwnn"; code39['A']="wnnnnwnnw"; code39['B']="nnwnnwnnw";
-        code39['C']="wnwnnwnnn"; code39['D']="nnnnwwnnw"; code39['E']="wnnnwwnnn";
-        code39['F']="nnwnwwnnn"; code39['G']="nnnnnwwnw"; code39['H']="wnnnnwwnn";
-        code39['I']="nnwnnwwnn"; code39['J']="nnnnwwwnn"; code39['K']="wnnnnnnww";
-        code39['L']="nnwnnnnww"; code39['M']="wnwnnnnwn"; code39['N']="nnnnwnnww";
-        code39['O']="wnnnwnnwn"; code39['P']="nnwnwnnwn"; code39['Q']="nnnnnnwww";
-        code39['R']="wnnnnnwwn"; code39['S']="nnwnnnwwn"; code39['T']="nnnnwnwwn";
-        code39['U']="wwnnnnnnw"; code39['V']="nwwnnnnnw"; code39['W']="wwwnnnnnn";
-        code39['X']="nwnnwnnnw"; code39['Y']="wwnnwnnnn"; code39['Z']="nwwnwnnnn";
-        code39['-']="nwnnnnwnw"; code39['.']="wwnnnnwnn"; code39[' ']="nwwnnnwnn";
-        code39['*']="nwnnwnwnn";
-        return code39;
-    }
-public:
-    Product(int id=0,string n="",double p=0,int s=0,string cat="")
-        : productId(id), name(n), price(p), stock(s), category(cat) {
-        if (price < 0) throw InvalidPriceException();
+    friend class StockSnapshot;
+    atomic<uint64_t> stockWord;
+    int32_t productId;
+    int32_t price; /* cents */
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint16_t categoryId;
+public:
+    Product(int id=0,string_view n=string_view(),double p=0,int s=0,const string& cat="")
+        : stockWord(StockVersions::pack(s,0)), productId(id), price(0), nameOffset(0), nameLength(0), categoryId(0) {
+        Cents cents=toCents(p);
+        if (p < 0 || cents > INT32_MAX) throw InvalidPriceException();
         if (s < 0) throw InvalidQuantityException();
-        barcode = "PRD" + to_string(id);
+        /* the CSV loader splits rows on raw newlines, so a name spanning lines could not be read back */
+        if (n.find_first_of("\r\n") != string_view::npos || cat.find_first_of("\r\n") != string::npos)
+            throw invalid_argument("Product name and category must fit on one line!");
+        price = (int32_t)cents;
+        ProductText& text=ProductText::shared();
+        nameOffset = text.appendName(n);
+        nameLength = (uint16_t)n.size();
+        if (!cat.empty()) categoryId = text.category(cat);
+    }
+    Product(const Product& o)
+        : stockWord(o.stockVersion()), productId(o.productId), price(o.price),
+          nameOffset(o.nameOffset), nameLength(o.nameLength), categoryId(o.categoryId) {}
+    Product& operator=(const Product& o) {
+        productId = o.productId; price = o.price;
+        stockWord.store(o.stockVersion(), memory_order_relaxed);
+        nameOffset = o.nameOffset; nameLength = o.nameLength; categoryId = o.categoryId;
+        return *this;
+    }
+    static string barcodeFor(int id) { return "PRD" + to_string(id); }
+    /* inverse of barcodeFor, -1 for anything it could not have produced */
+    static int idFromBarcode(string_view code) {
+        if (code.size() < 4 || code.size() > 13 || code.compare(0, 3, "PRD") != 0) return -1;
+        if (code[3] == '0' && code.size() > 4) return -1;
+        int64_t id = 0;
+        for (size_t i = 3; i < code.size(); i++) {
+            if (code[i] < '0' || code[i] > '9') return -1;
+            id = id * 10 + (code[i] - '0');
+        }
+        return id > INT32_MAX ? -1 : (int)id;
     }
-    void updateStock(int quantity) {
+    /* stock operations return the level they left behind */
+    int updateStock(int quantity) {
         if (quantity < 0) throw InvalidQuantityException();
-        stock += quantity;
+        return StockVersions::shared().apply(stockWord, productId, quantity, false);
     }
-    void reduceStock(int quantity) {
+    /* unchecked adjustment used when replaying already-validated history */
+    int applyStockDelta(int delta) { return StockVersions::shared().apply(stockWord, productId, delta, false); }
+    /* compare-and-swap so concurrent lanes can never take the count below zero */
+    int reduceStock(int quantity) {
         if (quantity < 0) throw InvalidQuantityException();
-        if (stock < quantity) throw InsufficientStockException();
-        stock -= quantity;
-    }
-    void generateBarcode(const string& filename) {
-        const int NARROW = 1, WIDE = 3; /* barcode line width macros*/
-        map<char,string> code39 = getCode39Map();
-        string full="*"+barcode+"*";
-        int height=50;
-        int totalWidth=0;
-        for(size_t i=0;i<full.length();i++){
-            string pattern=code39[full[i]];
-            for(int j=0;j<9;j++) totalWidth += (pattern[j]=='n'?NARROW:WIDE);
-            totalWidth+=NARROW;
-        }
-        ofstream out(filename);
+        return StockVersions::shared().apply(stockWord, productId, -quantity, true);
+    }
+    /* binary P4 by default; ascii=true writes the old P1 text format */
+    void generateBarcode(const string& filename, bool ascii = false) const {
+        string image = Code39::render("*" + getBarcode() + "*", ascii);
+        ofstream out(filename, ios::binary);
         if(!out) throw FileOperationException("Cannot create barcode file");
-        out<<"P1\n"<<totalWidth<<" "<<height<<"\n";
-        for(int row=0;row<height;row++){
-            for(size_t i=0;i<full.length();i++){
-                string pattern=code39[full[i]];
-                for(int j=0;j<9;j++){
-                    int width=(pattern[j]=='n'?NARROW:WIDE);
-                    bool isBar=(j%2==0);
-                    for(int w=0;w<width;w++) out<<(isBar?"1 ":"0 ");
-                }
-                for(int w=0;w<NARROW;w++) out<<"0 ";
-            }
-            out<<"\n";
-        }
-        out.close();
+        out.write(image.data(), image.size());
+        if(!out) throw FileOperationException("Cannot write barcode file");
     }
     void display() const {
+        int stock = getStock();
         string stockColor = stock < 20 ? RED : (stock < 50 ? YELLOW : GREEN);
         cout << BRIGHT_CYAN << "ID: " << RESET << productId 
-             << BRIGHT_CYAN << " | " << RESET << BOLD << name << RESET 
-             << BRIGHT_CYAN << " | " << RESET << GREEN << "$" << fixed << setprecision(2) << price << RESET
+             << BRIGHT_CYAN << " | " << RESET << BOLD << nameView() << RESET 
+             << BRIGHT_CYAN << " | " << RESET << GREEN << "$" << formatCents(price) << RESET
              << BRIGHT_CYAN << " | Stock: " << RESET << stockColor << stock << RESET
-             << BRIGHT_CYAN << " | Category: " << RESET << MAGENTA << category << RESET
-             << BRIGHT_CYAN << " | Barcode: " << RESET << YELLOW << barcode << RESET << endl;
+             << BRIGHT_CYAN << " | Category: " << RESET << MAGENTA << getCategory() << RESET
+             << BRIGHT_CYAN << " | Barcode: " << RESET << YELLOW << getBarcode() << RESET << endl;
     }
-    void saveToFile(ofstream& out) const {
-        out<<productId<<","<<name<<","<<price<<","<<stock<<","<<category<<"\n";
+    void saveToFile(ofstream& out) const { saveToFile(out, getStock()); }
+    void saveToFile(ofstream& out, int stock) const {
+        out<<productId<<","<<csvField(getName())<<","<<formatCents(price)<<","<<stock<<","<<csvField(getCategory())<<"\n";
     }
     int getId() const { return productId; }
-    string getName() const { return name; }
-    double getPrice() const { return price; }
-    int getStock() const { return stock; }
-    string getBarcode() const { return barcode; }
+    string getName() const { return string(nameView()); }
+    string_view nameView() const { return ProductText::shared().name(nameOffset, nameLength); }
+    double getPrice() const { return price/100.0; }
+    Cents getPriceCents() const { return (Cents)price; }
+    const string& getCategory() const { return ProductText::shared().categoryName(categoryId); }
+    uint16_t getCategoryId() const { return categoryId; }
+    int getStock() const { return StockVersions::stockOf(stockWord.load(memory_order_relaxed)); }
+    uint64_t stockVersion() const { return stockWord.load(memory_order_acquire); }
+    string getBarcode() const { return barcodeFor(productId); }
+};
+
+/* consistent stock levels for a report: every basket that finished before it opened, none that
+   started after. Checkout keeps running meanwhile */
+class StockSnapshot {
+private:
+    StockVersions::Version* version;
+public:
+    StockSnapshot() : version(StockVersions::shared().open()) {}
+    ~StockSnapshot(){ StockVersions::shared().close(version); }
+    StockSnapshot(const StockSnapshot&)=delete;
+    StockSnapshot& operator=(const StockSnapshot&)=delete;
+    int stock(const Product& p) const { return StockVersions::stockAt(*version,p.stockWord,p.getId()); }
+};
+
+/* products live in id-indexed chunks of compact records. Barcodes are PRD<id>, so a scan parses the
+   id back out instead of keeping a barcode index.
+   find() is lock-free so checkout lanes can look products up while new ones are being added */
+class ProductStore {
+private:
+    ChunkedArray<Product> slots;
+    ChunkedArray<int> slotById;
+    mutex insertLock;
+    atomic<size_t> count;
+    atomic<int> minId, maxId;
+public:
+    ProductStore() : count(0), minId(0), maxId(-1) {}
+    Product* find(int id){
+        if(id<minId.load(memory_order_acquire)||id>maxId.load(memory_order_acquire)) return nullptr;
+        int slot=slotById[id];
+        return slot<0?nullptr:&slots[slot];
+    }
+    Product* findByBarcode(string_view barcode){
+        int id=Product::idFromBarcode(barcode);
+        return id<0?nullptr:find(id);
+    }
+    /* replacing an existing id overwrites the record in place and must not race with checkout */
+    Product& insert(Product p){
+        int id=p.getId();
+        if(id<0||(size_t)id>=ChunkedArray<int>::MAX_SIZE) throw InvalidProductIdException();
+        lock_guard<mutex> lock(insertLock);
+        Product* existing=find(id);
+        if(existing){
+            *existing=move(p);
+            return *existing;
+        }
+        slotById.ensure((size_t)id+1,-1);
+        size_t n=count.load(memory_order_relaxed);
+        slots.ensure(n+1);
+        int slot=(int)n;
+        slots[slot]=move(p);
+        slotById[id]=slot;
+        if(n==0||id<minId.load(memory_order_relaxed)) minId.store(id,memory_order_release);
+        if(id>maxId.load(memory_order_relaxed)) maxId.store(id,memory_order_release);
+        count.store(n+1,memory_order_release);
+        return slots[slot];
+    }
+    void reserve(size_t n){
+        lock_guard<mutex> lock(insertLock);
+        slots.ensure(n);
+    }
+    size_t size() const { return count.load(memory_order_acquire); }
+    bool empty() const { return size()==0; }
+    /* visits products in ascending id order, like the old map did */
+    template<typename F>
+    void forEach(F f){
+        int last=maxId.load(memory_order_acquire);
+        for(int id=minId.load(memory_order_acquire);id<=last;id++){
+            int slot=slotById[id];
+            if(slot>=0) f(slots[slot]);
+        }
+    }
+};
+
+/* one sold line: the price is captured at sale time so history does not follow later price edits;
+   discount is the promotion saving on the whole line */
+struct LineItem {
+    int32_t productId;
+    int32_t quantity;
+    Cents unitPrice;
+    Cents discount;
+};
+
+/* Promotion rules compiled into id-indexed tables. Every rule edit rebuilds an immutable table set
+   and publishes it with one pointer swap, so lanes price baskets without taking a lock.
+   Bundles take their units first; each product's remaining units then get the better of its
+   multi-buy offer and its category discount. */
+class PricingEngine {
+public:
+    enum RuleKind : uint8_t { MULTI_BUY = 1, CATEGORY_PERCENT = 2, BUNDLE = 3 };
+    struct Rule {
+        int id;
+        RuleKind kind;
+        int productId, buy, get;     /* multi-buy: out of every buy+get units, get are free */
+        string category;
+        int basisPoints;             /* category discount, 1550 = 15.5% */
+        vector<int> products;        /* bundle: one unit of each ... */
+        Cents bundlePrice;           /* ... sold together for this price */
+        Rule() : id(0), kind(MULTI_BUY), productId(0), buy(0), get(0), basisPoints(0), bundlePrice(0) {}
+    };
+private:
+    struct MultiBuy { int32_t buy, get; };
+    struct Tables {
+        vector<MultiBuy> multiBuy;         /* by product id, buy==0 for none */
+        vector<int32_t> categoryDiscount;  /* basis points by category id */
+        vector<uint32_t> bundleStart;      /* bundles containing product id: bundleOf[bundleStart[id]..] */
+        vector<int32_t> bundleOf;
+        vector<uint32_t> componentStart;   /* products of bundle b: components[componentStart[b]..] */
+        vector<int32_t> components;
+        vector<Cents> bundlePrice;
+        bool empty;
+    };
+    /* per-lane working set, reset in O(1) by bumping a generation stamp */
+    struct Scratch {
+        struct Entry { int32_t productId; int32_t quantity, bundled; uint32_t firstLine; };
+        vector<Entry> entries;
+        vector<int32_t> slot;
+        vector<uint32_t> slotStamp, bundleStamp, bundleHits;
+        vector<int32_t> touched;
+        uint32_t generation;
+        Scratch() : generation(0) {}
+        void begin(size_t lines,size_t bundles){
+            size_t want=16;
+            while(want<lines*2) want<<=1;
+            if(++generation==0){
+                fill(slotStamp.begin(),slotStamp.end(),0);
+                fill(bundleStamp.begin(),bundleStamp.end(),0);
+                generation=1;
+            }
+            if(slot.size()<want){ slot.assign(want,0); slotStamp.assign(want,0); }
+            if(bundleStamp.size()<bundles){ bundleStamp.resize(bundles,0); bundleHits.resize(bundles,0); }
+            entries.clear();
+            touched.clear();
+        }
+        Entry* find(int productId,bool create,uint32_t line=0){
+            size_t mask=slot.size()-1;
+            for(size_t h=(uint32_t)productId*2654435761u&mask;;h=(h+1)&mask){
+                if(slotStamp[h]!=generation){
+                    if(!create) return nullptr;
+                    slotStamp[h]=generation;
+                    slot[h]=(int32_t)entries.size();
+                    entries.push_back(Entry{productId,0,0,line});
+                    return &entries.back();
+                }
+                if(entries[slot[h]].productId==productId) return &entries[slot[h]];
+            }
+        }
+    };
+    ChunkedArray<int> productCategory;
+    int maxProductId;
+    unordered_map<string,int> categoryIds;
+    vector<Rule> rules;
+    int nextRuleId;
+    shared_ptr<const Tables> tables;
+    int internCategory(const string& category){
+        auto it=categoryIds.find(category);
+        if(it!=categoryIds.end()) return it->second;
+        int id=(int)categoryIds.size();
+        categoryIds[category]=id;
+        return id;
+    }
+    void compile(){
+        shared_ptr<Tables> t=make_shared<Tables>();
+        int maxId=-1, bundles=0;
+        for(auto& r:rules){
+            if(r.kind==MULTI_BUY) maxId=max(maxId,r.productId);
+            if(r.kind==BUNDLE){ bundles++; for(int id:r.products) maxId=max(maxId,id); }
+        }
+        t->multiBuy.assign((size_t)(maxId+1),MultiBuy{0,0});
+        t->categoryDiscount.assign(categoryIds.size(),0);
+        t->bundleStart.assign((size_t)(maxId+2),0);
+        t->componentStart.push_back(0);
+        for(auto& r:rules){
+            if(r.kind==MULTI_BUY) t->multiBuy[r.productId]=MultiBuy{r.buy,r.get};
+            else if(r.kind==CATEGORY_PERCENT){
+                int32_t& bp=t->categoryDiscount[categoryIds[r.category]];
+                bp=max(bp,(int32_t)r.basisPoints);
+            } else{
+                for(int id:r.products){ t->components.push_back(id); t->bundleStart[id+1]++; }
+                t->componentStart.push_back((uint32_t)t->components.size());
+                t->bundlePrice.push_back(r.bundlePrice);
+            }
+        }
+        for(size_t i=1;i<t->bundleStart.size();i++) t->bundleStart[i]+=t->bundleStart[i-1];
+        t->bundleOf.resize(t->components.size());
+        vector<uint32_t> next(t->bundleStart.begin(),t->bundleStart.end()-(t->bundleStart.empty()?0:1));
+        for(int b=0;b<bundles;b++)
+            for(uint32_t k=t->componentStart[b];k<t->componentStart[b+1];k++)
+                t->bundleOf[next[t->components[k]]++]=b;
+        t->empty=rules.empty();
+        atomic_store(&tables,shared_ptr<const Tables>(t));
+    }
+    static Scratch& scratch(){
+        thread_local Scratch s;
+        return s;
+    }
+public:
+    PricingEngine() : maxProductId(-1), nextRuleId(1) { compile(); }
+    /* products and rules change from the menu or loaders, never while lanes are checking out */
+    void registerProduct(int id,const string& category){
+        if(id<0) return;
+        if(id>maxProductId){
+            productCategory.ensure((size_t)id+1,-1);
+            maxProductId=id;
+        }
+        productCategory[id]=internCategory(category);
+    }
+    /* returns the rule id; recovery passes the id it had before */
+    int addRule(Rule rule){
+        if(rule.kind==MULTI_BUY&&(rule.productId<0||rule.buy<1||rule.get<1))
+            throw invalid_argument("Multi-buy needs a product and positive buy/get counts!");
+        if(rule.kind==CATEGORY_PERCENT&&(rule.basisPoints<1||rule.basisPoints>10000))
+            throw invalid_argument("Category discount must be between 0.01% and 100%!");
+        if(rule.kind==BUNDLE){
+            sort(rule.products.begin(),rule.products.end());
+            rule.products.erase(unique(rule.products.begin(),rule.products.end()),rule.products.end());
+            if(rule.products.size()<2||rule.products.front()<0||rule.bundlePrice<0)
+                throw invalid_argument("A bundle needs at least two different products and a price!");
+        }
+        if(rule.kind==CATEGORY_PERCENT) internCategory(rule.category);
+        if(rule.id<=0) rule.id=nextRuleId;
+        nextRuleId=max(nextRuleId,rule.id+1);
+        rules.push_back(rule);
+        compile();
+        return rule.id;
+    }
+    bool removeRule(int id){
+        for(size_t i=0;i<rules.size();i++){
+            if(rules[i].id!=id) continue;
+            rules.erase(rules.begin()+i);
+            compile();
+            return true;
+        }
+        return false;
+    }
+    const vector<Rule>& getRules() const { return rules; }
+    /* fills each line's discount and returns the basket's total saving */
+    Cents apply(vector<LineItem>& lines) const {
+        for(auto& line:lines) line.discount=0;
+        shared_ptr<const Tables> t=atomic_load(&tables);
+        if(t->empty||lines.empty()) return 0;
+        Scratch& s=scratch();
+        s.begin(lines.size(),t->bundlePrice.size());
+        for(uint32_t i=0;i<lines.size();i++)
+            s.find(lines[i].productId,true,i)->quantity+=lines[i].quantity;
+        if(!t->bundlePrice.empty()){
+            for(auto& e:s.entries){
+                if(e.productId<0||(size_t)e.productId+1>=t->bundleStart.size()) continue;
+                for(uint32_t k=t->bundleStart[e.productId];k<t->bundleStart[e.productId+1];k++){
+                    int b=t->bundleOf[k];
+                    if(s.bundleStamp[b]!=s.generation){ s.bundleStamp[b]=s.generation; s.bundleHits[b]=0; s.touched.push_back(b); }
+                    s.bundleHits[b]++;
+                }
+            }
+            sort(s.touched.begin(),s.touched.end());
+            for(int b:s.touched){
+                uint32_t from=t->componentStart[b], to=t->componentStart[b+1];
+                if(s.bundleHits[b]!=to-from) continue;
+                int32_t sets=INT32_MAX;
+                Cents regular=0;
+                for(uint32_t k=from;k<to;k++){
+                    Scratch::Entry* e=s.find(t->components[k],false);
+                    sets=min(sets,e->quantity-e->bundled);
+                    regular+=lines[e->firstLine].unitPrice;
+                }
+                if(sets<=0||regular<=t->bundlePrice[b]) continue;
+                Cents saving=(regular-t->bundlePrice[b])*sets, left=saving;
+                for(uint32_t k=from;k<to;k++){
+                    Scratch::Entry* e=s.find(t->components[k],false);
+                    Cents share=k+1==to?left:saving*lines[e->firstLine].unitPrice/regular;
+                    lines[e->firstLine].discount+=share;
+                    left-=share;
+                    e->bundled+=sets;
+                }
+            }
+        }
+        Cents total=0;
+        for(auto& e:s.entries){
+            int32_t units=e.quantity-e.bundled;
+            LineItem& line=lines[e.firstLine];
+            if(units>0&&e.productId>=0){
+                Cents best=0;
+                if((size_t)e.productId<t->multiBuy.size()){
+                    const MultiBuy& mb=t->multiBuy[e.productId];
+                    if(mb.buy>0) best=(Cents)(units/(mb.buy+mb.get))*mb.get*line.unitPrice;
+                }
+                int cat=e.productId<=maxProductId?productCategory[e.productId]:-1;
+                if(cat>=0&&(size_t)cat<t->categoryDiscount.size()&&t->categoryDiscount[cat]>0)
+                    best=max(best,(units*line.unitPrice*t->categoryDiscount[cat]+5000)/10000);
+                line.discount+=best;
+            }
+            total+=line.discount;
+        }
+        return total;
+    }
+    static string describe(const Rule& r){
+        if(r.kind==MULTI_BUY)
+            return "Product "+to_string(r.productId)+": buy "+to_string(r.buy)+" get "+to_string(r.get)+" free";
+        if(r.kind==CATEGORY_PERCENT)
+            return r.category+": "+formatCents(r.basisPoints)+"% off";
+        string text="Bundle";
+        for(size_t i=0;i<r.products.size();i++) text+=(i?" + ":" ")+to_string(r.products[i]);
+        return text+" for $"+formatCents(r.bundlePrice);
+    }
+};
+
+/* operations timed by the statistics layer; STAT_OP_COUNT must stay last */
+enum StatOp : uint8_t { STAT_CHECKOUT, STAT_ADD_ITEM, STAT_COMMIT, STAT_WAL_APPEND, STAT_WAL_SYNC, STAT_RECEIPT_WRITE,
+                        STAT_SEARCH, STAT_SAVE_PRODUCTS, STAT_SAVE_EMPLOYEES, STAT_LOAD_PRODUCTS, STAT_CHECKPOINT,
+                        STAT_REQUEST, STAT_OP_COUNT };
+const char* const STAT_OP_NAMES[STAT_OP_COUNT] = {
+    "checkout","add_item","commit","wal_append","wal_sync","receipt_write",
+    "search","save_products","save_employees","load_products","checkpoint","request"
+};
+
+/* raw timestamps: the TSC on x86 (a few cycles to read), steady_clock nanoseconds elsewhere.
+   Ticks are converted to nanoseconds only when statistics are read. */
+class StatClock {
+private:
+    struct Origin {
+        uint64_t ticks;
+        chrono::steady_clock::time_point time;
+        Origin() : ticks(StatClock::now()), time(chrono::steady_clock::now()) {}
+    };
+    static const Origin& origin(){
+        static Origin o;
+        return o;
+    }
+public:
+    static uint64_t now(){
+#if defined(__x86_64__)||defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+    static void start(){ origin(); }
+    static double secondsSinceStart(){ return chrono::duration<double>(chrono::steady_clock::now()-origin().time).count(); }
+    /* calibrated against steady_clock over the whole run, so it gets more exact the longer we run */
+    static double nanosPerTick(){
+#if defined(__x86_64__)||defined(__i386__)
+        double ns=secondsSinceStart()*1e9;
+        uint64_t ticks=now()-origin().ticks;
+        return ns>1e6&&ticks>0?ns/ticks:0.3;
+#else
+        return 1;
+#endif
+    }
+};
+
+/* log-linear latency histogram layout: values below 16 ticks are exact, above that every power of
+   two is split into 16 buckets, so any recorded value is within 1/16 of its bucket */
+struct StatHistogram {
+    static const int SUB_BITS = 4;
+    static const int SUB = 1<<SUB_BITS;
+    static const int BUCKETS = SUB*61;
+    static int bucket(uint64_t v){
+        if(v<(uint64_t)SUB) return (int)v;
+        int shift=63-__builtin_clzll(v)-SUB_BITS;
+        return (shift+1)*SUB+(int)((v>>shift)&(SUB-1));
+    }
+    static uint64_t lowerBound(int b){
+        if(b<SUB) return (uint64_t)b;
+        int shift=b/SUB-1;
+        return (uint64_t)(SUB+b%SUB)<<shift;
+    }
+};
+
+/* merged view of every thread's counters; count has every event, the buckets only the timed ones */
+struct StatSnapshot {
+    vector<uint64_t> buckets; /* STAT_OP_COUNT * BUCKETS */
+    uint64_t count[STAT_OP_COUNT], timed[STAT_OP_COUNT], bytes[STAT_OP_COUNT], maxTicks[STAT_OP_COUNT];
+    double seconds, nanosPerTick;
+    StatSnapshot() : buckets((size_t)STAT_OP_COUNT*StatHistogram::BUCKETS,0), seconds(0), nanosPerTick(1) {
+        for(int i=0;i<STAT_OP_COUNT;i++) count[i]=timed[i]=bytes[i]=maxTicks[i]=0;
+    }
+    /* q-quantile of op in microseconds, reported at the middle of its bucket */
+    double percentileMicros(int op,double q) const {
+        if(timed[op]==0) return 0;
+        uint64_t rank=(uint64_t)ceil(q*timed[op]), seen=0;
+        const uint64_t* b=&buckets[(size_t)op*StatHistogram::BUCKETS];
+        for(int i=0;i<StatHistogram::BUCKETS;i++){
+            seen+=b[i];
+            if(seen>=max<uint64_t>(rank,1)){
+                double low=(double)StatHistogram::lowerBound(i);
+                double high=i+1<StatHistogram::BUCKETS?(double)StatHistogram::lowerBound(i+1):low;
+                return min((low+high)/2,(double)maxTicks[op])*nanosPerTick/1000;
+            }
+        }
+        return maxTicks[op]*nanosPerTick/1000;
+    }
+    /* what happened between an earlier snapshot and this one; the maximum stays cumulative */
+    StatSnapshot since(const StatSnapshot& earlier) const {
+        StatSnapshot d(*this);
+        for(size_t i=0;i<buckets.size();i++) d.buckets[i]-=earlier.buckets[i];
+        for(int i=0;i<STAT_OP_COUNT;i++){
+            d.count[i]-=earlier.count[i];
+            d.timed[i]-=earlier.timed[i];
+            d.bytes[i]-=earlier.bytes[i];
+        }
+        d.seconds=seconds-earlier.seconds;
+        return d;
+    }
 };
 
+/* Every thread records into its own shard with plain relaxed loads and stores, so an event costs two
+   clock reads and a couple of cache-local increments. Per-line operations only time every Nth call
+   and count the rest. Readers sum the live shards with the totals that exited threads folded in on
+   their way out. */
+class Stats {
+private:
+    struct Shard {
+        atomic<uint64_t> buckets[STAT_OP_COUNT][StatHistogram::BUCKETS];
+        atomic<uint64_t> events[STAT_OP_COUNT], bytes[STAT_OP_COUNT], maxTicks[STAT_OP_COUNT];
+        uint32_t sampleClock; /* owner thread only */
+        Shard() : sampleClock(0) {
+            for(int op=0;op<STAT_OP_COUNT;op++){
+                for(auto& b:buckets[op]) b.store(0,memory_order_relaxed);
+                events[op].store(0,memory_order_relaxed);
+                bytes[op].store(0,memory_order_relaxed);
+                maxTicks[op].store(0,memory_order_relaxed);
+            }
+        }
+    };
+    struct Registry {
+        mutex lock;
+        vector<Shard*> live;
+        StatSnapshot retired;
+    };
+    static Registry& registry(){
+        static Registry r;
+        return r;
+    }
+    static void addTo(StatSnapshot& s,const Shard& shard){
+        for(int op=0;op<STAT_OP_COUNT;op++){
+            uint64_t* out=&s.buckets[(size_t)op*StatHistogram::BUCKETS];
+            for(int i=0;i<StatHistogram::BUCKETS;i++){
+                uint64_t n=shard.buckets[op][i].load(memory_order_relaxed);
+                out[i]+=n;
+                s.timed[op]+=n;
+            }
+            s.count[op]+=shard.events[op].load(memory_order_relaxed);
+            s.bytes[op]+=shard.bytes[op].load(memory_order_relaxed);
+            s.maxTicks[op]=max(s.maxTicks[op],shard.maxTicks[op].load(memory_order_relaxed));
+        }
+    }
+    struct Handle {
+        Shard* shard;
+        Handle() : shard(new Shard()) {
+            Registry& r=registry();
+            lock_guard<mutex> guard(r.lock);
+            r.live.push_back(shard);
+        }
+        ~Handle(){
+            Registry& r=registry();
+            lock_guard<mutex> guard(r.lock);
+            addTo(r.retired,*shard);
+            r.live.erase(find(r.live.begin(),r.live.end(),shard));
+            delete shard;
+        }
+    };
+    static Shard& local(){
+        thread_local Handle h;
+        return *h.shard;
+    }
+    static void bump(atomic<uint64_t>& counter,uint64_t n){
+        counter.store(counter.load(memory_order_relaxed)+n,memory_order_relaxed);
+    }
+    static void recordTiming(Shard& s,StatOp op,uint64_t ticks){
+        bump(s.buckets[op][StatHistogram::bucket(ticks)],1);
+        if(ticks>s.maxTicks[op].load(memory_order_relaxed)) s.maxTicks[op].store(ticks,memory_order_relaxed);
+    }
+public:
+    static void record(StatOp op,uint64_t ticks){
+        Shard& s=local();
+        bump(s.events[op],1);
+        recordTiming(s,op,ticks);
+    }
+    /* counts an event and says whether it is the one in every that gets timed */
+    static bool sample(StatOp op,uint32_t every){
+        Shard& s=local();
+        bump(s.events[op],1);
+        return ++s.sampleClock%every==0;
+    }
+    static void recordSample(StatOp op,uint64_t ticks){ recordTiming(local(),op,ticks); }
+    static void addBytes(StatOp op,uint64_t n){ bump(local().bytes[op],n); }
+    static StatSnapshot snapshot(){
+        StatSnapshot s;
+        Registry& r=registry();
+        {
+            lock_guard<mutex> guard(r.lock);
+            s.buckets=r.retired.buckets;
+            for(int op=0;op<STAT_OP_COUNT;op++){
+                s.count[op]=r.retired.count[op];
+                s.timed[op]=r.retired.timed[op];
+                s.bytes[op]=r.retired.bytes[op];
+                s.maxTicks[op]=r.retired.maxTicks[op];
+            }
+            for(Shard* shard:r.live) addTo(s,*shard);
+        }
+        s.seconds=StatClock::secondsSinceStart();
+        s.nanosPerTick=StatClock::nanosPerTick();
+        return s;
+    }
+    static bool enabled(){
+#ifdef STOX_NO_STATS
+        return false;
+#else
+        return true;
+#endif
+    }
+    static void display(const StatSnapshot& s){
+        cout << "\n" << BOLD << BG_BLUE << WHITE << "           RUNTIME STATISTICS           " << RESET << "\n";
+        if(!enabled()){
+            cout << YELLOW << "⚠ Statistics were compiled out (STOX_NO_STATS)." << RESET << "\n";
+            return;
+        }
+        cout << CYAN << left << setw(16) << "Operation" << right << setw(10) << "Count" << setw(11) << "ops/s"
+             << setw(11) << "p50 us" << setw(11) << "p99 us" << setw(11) << "p99.9 us" << setw(11) << "max us"
+             << setw(12) << "bytes" << RESET << "\n";
+        for(int op=0;op<STAT_OP_COUNT;op++){
+            if(s.count[op]==0&&s.bytes[op]==0) continue;
+            cout << left << setw(16) << STAT_OP_NAMES[op] << right << setw(10) << s.count[op] << fixed << setprecision(0)
+                 << setw(11) << (s.seconds>0?s.count[op]/s.seconds:0) << setprecision(2)
+                 << setw(11) << s.percentileMicros(op,0.50) << setw(11) << s.percentileMicros(op,0.99)
+                 << setw(11) << s.percentileMicros(op,0.999) << setw(11) << s.maxTicks[op]*s.nanosPerTick/1000
+                 << setw(12) << s.bytes[op] << "\n";
+        }
+        cout << CYAN << "Over " << RESET << fixed << setprecision(1) << s.seconds << "s since start\n";
+    }
+};
+
+/* times the enclosing scope */
+class StatTimer {
+private:
+    StatOp op;
+    uint64_t start;
+public:
+    explicit StatTimer(StatOp o) : op(o), start(StatClock::now()) {}
+    ~StatTimer(){ Stats::record(op,StatClock::now()-start); }
+};
+
+/* counts every call but only reads the clock for one in every */
+class StatSampledTimer {
+private:
+    StatOp op;
+    uint64_t start;
+public:
+    StatSampledTimer(StatOp o,uint32_t every) : op(o), start(Stats::sample(o,every)?StatClock::now():0) {}
+    ~StatSampledTimer(){ if(start) Stats::recordSample(op,StatClock::now()-start); }
+};
+
+/* -DSTOX_NO_STATS compiles every hook out */
+#ifndef STOX_NO_STATS
+#define STAT_CONCAT2(a,b) a##b
+#define STAT_CONCAT(a,b) STAT_CONCAT2(a,b)
+#define STAT_SCOPE(op) StatTimer STAT_CONCAT(statTimer,__LINE__)(op)
+#define STAT_SAMPLED_SCOPE(op,every) StatSampledTimer STAT_CONCAT(statTimer,__LINE__)(op,every)
+#define STAT_BYTES(op,n) Stats::addBytes(op,(uint64_t)(n))
+#else
+#define STAT_SCOPE(op) do{}while(0)
+#define STAT_SAMPLED_SCOPE(op,every) do{}while(0)
+#define STAT_BYTES(op,n) do{}while(0)
+#endif
+
+/* notified for every line successfully added to a basket */
+class SaleListener {
+public:
+    virtual ~SaleListener() {}
+    virtual void onItemSold(const Product& product,int quantity,Cents unitPrice,int stockLeft) = 0;
+};
+
+/* basket being rung up; it only becomes a numbered transaction when committed to the journal */
 class Transaction {
 private:
-    int transactionId;
-    vector<pair<Product*, int>> items;
-    double totalAmount;
-    string date;
     int cashierId;
-    string getCurrentDate() {
-        time_t now=time(0);
-        struct tm* t=localtime(&now);
-        char buf[80]; /* we need to use c style char* to use time structs */
-        strftime(buf,sizeof(buf),"%Y-%m-%d %H:%M:%S",t);
-        return string(buf);
-    }
+    vector<LineItem> items;
+    Cents totalAmount, discountAmount;
+    SaleListener* listener;
 public:
-    Transaction(int id,int cashier)
-        : transactionId(id), totalAmount(0), cashierId(cashier) {
-        date = getCurrentDate();
+    Transaction(int cashier=0,SaleListener* l=nullptr)
+        : cashierId(cashier), totalAmount(0), discountAmount(0), listener(l) {}
+    void reset(int cashier,SaleListener* l=nullptr){
+        cashierId=cashier;
+        items.clear();
+        totalAmount=discountAmount=0;
+        listener=l;
     }
     void addItem(Product* product,int quantity){
+        STAT_SAMPLED_SCOPE(STAT_ADD_ITEM,16);
         if(!product) throw ProductNotFoundException();
         if(quantity<=0) throw InvalidQuantityException();
-        product->reduceStock(quantity);
-        items.push_back(make_pair(product,quantity));
-        totalAmount += product->getPrice()*quantity;
+        int left=product->reduceStock(quantity);
+        Cents unit=product->getPriceCents();
+        items.push_back(LineItem{product->getId(),quantity,unit,0});
+        totalAmount += unit*quantity;
+        if(listener) listener->onItemSold(*product,quantity,unit,left);
     }
-    void generateReceipt(const string& filename){
-        ofstream out(filename);
-        if(!out) throw FileOperationException("Cannot create receipt file");
-        out<<"========================================\n";
-        out<<"               OBA MARKET\n";
-        out<<"========================================\n";
-        out<<"Transaction ID: "<<transactionId<<"\n";
-        out<<"Date: "<<date<<"\n";
-        out<<"Cashier ID: "<<cashierId<<"\n";
-        out<<"----------------------------------------\n";
-        out<<left<<setw(20)<<"Item"<<setw(8)<<"Qty"<<setw(10)<<"Price"<<"Total\n";
-        out<<"----------------------------------------\n";
-        for(size_t i=0;i<items.size();i++){
-            out<<left<<setw(20)<<items[i].first->getName()
-                <<setw(8)<<items[i].second
-                <<"$"<<setw(9)<<fixed<<setprecision(2)<<items[i].first->getPrice()
-                <<"$"<<(items[i].first->getPrice()*items[i].second)<<"\n";
-        }
-        out<<"========================================\n";
-        out<<"TOTAL: $"<<fixed<<setprecision(2)<<totalAmount<<"\n";
-        out<<"========================================\n";
-        out<<"      Qarabağ Azərbaycandır!\n";
-        out<<"========================================\n";
-    }
-    double getTotal() const { return totalAmount; }
-    void display() const {
-        cout << BRIGHT_YELLOW << "Transaction ID: " << RESET << transactionId 
-             << BRIGHT_YELLOW << " | Date: " << RESET << date
-             << BRIGHT_YELLOW << " | Cashier: " << RESET << cashierId 
-             << BRIGHT_YELLOW << " | Total: " << RESET << BRIGHT_GREEN << "$" << fixed
-             << setprecision(2) << totalAmount << RESET << endl;
+    /* prices the finished basket against the active promotions */
+    void applyPromotions(const PricingEngine& pricing){ discountAmount=pricing.apply(items); }
+    const vector<LineItem>& getItems() const { return items; }
+    Cents getSubtotal() const { return totalAmount; }
+    Cents getDiscount() const { return discountAmount; }
+    Cents getTotal() const { return totalAmount-discountAmount; }
+    int getCashierId() const { return cashierId; }
+    size_t getItemCount() const { return items.size(); }
+};
+
+string formatTimestamp(int64_t when){
+    time_t t=(time_t)when;
+    struct tm parts;
+    localtime_r(&t,&parts); /* localtime() shares one static buffer between lanes */
+    char buf[80]; /* we need to use c style char* to use time structs */
+    strftime(buf,sizeof(buf),"%Y-%m-%d %H:%M:%S",&parts);
+    return string(buf);
+}
+
+/* accepts "YYYY-MM-DD", "YYYY-MM-DD HH:MM" or "YYYY-MM-DD HH:MM:SS" in local time, -1 if unparsable */
+int64_t parseTimestamp(const string& text){
+    const char* formats[]={"%Y-%m-%d %H:%M:%S","%Y-%m-%d %H:%M","%Y-%m-%d"};
+    for(const char* format:formats){
+        struct tm parts={};
+        const char* end=strptime(text.c_str(),format,&parts);
+        if(end&&*end=='\0'){
+            parts.tm_isdst=-1;
+            return (int64_t)mktime(&parts);
+        }
+    }
+    return -1;
+}
+
+/* one end of an inclusive date range; as the upper end a bare date takes in that whole day */
+int64_t parseRangeEnd(const string& text,bool upper){
+    int64_t when=parseTimestamp(text);
+    if(when<0) throw invalid_argument("Unparsable date: "+text);
+    if(upper&&text.size()==10){
+        struct tm parts={};
+        strptime(text.c_str(),"%Y-%m-%d",&parts);
+        parts.tm_mday++; /* the last second before the next midnight, whatever the day's length */
+        parts.tm_isdst=-1;
+        when=(int64_t)mktime(&parts)-1;
+    }
+    return when;
+}
+
+/* appends one CSV row per active operation every interval: that interval's rate and percentiles */
+class StatsReporter {
+private:
+    string path;
+    int intervalSeconds;
+    mutex lock;
+    condition_variable wake;
+    bool stopping;
+    thread worker;
+    void writeInterval(const StatSnapshot& d){
+        bool fresh=!filesystem::exists(path);
+        ofstream out(path,ios::app);
+        if(!out) return;
+        if(fresh) out<<"Time,Operation,Count,OpsPerSec,P50us,P99us,P999us,MaxUs,Bytes\n";
+        string when=formatTimestamp((int64_t)time(0));
+        for(int op=0;op<STAT_OP_COUNT;op++){
+            if(d.count[op]==0&&d.bytes[op]==0) continue;
+            out<<when<<","<<STAT_OP_NAMES[op]<<","<<d.count[op]<<","<<fixed<<setprecision(1)
+               <<(d.seconds>0?d.count[op]/d.seconds:0)<<","<<setprecision(2)<<d.percentileMicros(op,0.50)<<","
+               <<d.percentileMicros(op,0.99)<<","<<d.percentileMicros(op,0.999)<<","
+               <<d.maxTicks[op]*d.nanosPerTick/1000<<","<<d.bytes[op]<<"\n";
+        }
+    }
+    void reportLoop(){
+        StatSnapshot previous=Stats::snapshot();
+        unique_lock<mutex> guard(lock);
+        while(!stopping){
+            wake.wait_for(guard,chrono::seconds(intervalSeconds),[this]{ return stopping; });
+            guard.unlock();
+            StatSnapshot now=Stats::snapshot();
+            writeInterval(now.since(previous));
+            previous=move(now);
+            guard.lock();
+        }
+    }
+public:
+    StatsReporter(const string& file,int seconds) : path(file), intervalSeconds(max(1,seconds)), stopping(false) {
+        if(Stats::enabled()) worker=thread(&StatsReporter::reportLoop,this);
+    }
+    StatsReporter(const StatsReporter&) = delete;
+    StatsReporter& operator=(const StatsReporter&) = delete;
+    ~StatsReporter(){
+        {
+            lock_guard<mutex> guard(lock);
+            stopping=true;
+        }
+        wake.notify_one();
+        if(worker.joinable()) worker.join();
     }
 };
 
-class SupermarketManager {
+class MappedFile {
 private:
-    map<int,Product*> products;
-    vector<Employee*> employees;
-    queue<Transaction*> transactions;
-    int nextProductId;
-    int nextEmployeeId;
-    int nextTransactionId;
+    const char* data;
+    size_t length;
 public:
-    SupermarketManager()
-        : nextProductId(1001), nextEmployeeId(1), nextTransactionId(1) {}
-    ~SupermarketManager(){
-        for(auto& p:products) delete p.second;
-        for(auto e:employees) delete e;
-        while(!transactions.empty()){
-            delete transactions.front();
-            transactions.pop();
+    MappedFile(const string& filename) : data(nullptr), length(0) {
+        int fd=open(filename.c_str(),O_RDONLY);
+        if(fd<0) throw FileOperationException("Cannot open "+filename);
+        struct stat st;
+        if(fstat(fd,&st)!=0){ close(fd); throw FileOperationException("Cannot stat "+filename); }
+        length=(size_t)st.st_size;
+        if(length>0){
+            void* mapped=mmap(nullptr,length,PROT_READ,MAP_PRIVATE,fd,0);
+            if(mapped==MAP_FAILED){ close(fd); throw FileOperationException("Cannot map "+filename); }
+            madvise(mapped,length,MADV_SEQUENTIAL);
+            data=(const char*)mapped;
+        }
+        close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile(){ if(data) munmap((void*)data,length); }
+    const char* begin() const { return data; }
+    const char* end() const { return data+length; }
+    size_t size() const { return length; }
+};
+
+/* parses products.csv in parallel chunks cut on line boundaries; fields may be double-quoted */
+class ProductCsvParser {
+private:
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        vector<Product> rows;
+        size_t lines;
+        size_t errorLine; /* 1-based line within the chunk, 0 = no error */
+        Chunk() : begin(nullptr), end(nullptr), lines(0), errorLine(0) {}
+    };
+    static string_view trim(string_view v){
+        while(!v.empty()&&(v.front()==' '||v.front()=='\t')) v.remove_prefix(1);
+        while(!v.empty()&&(v.back()==' '||v.back()=='\t'||v.back()=='\r')) v.remove_suffix(1);
+        return v;
+    }
+    /* returns the field at p and moves p past its separator; quoted fields are unescaped into scratch */
+    static string_view nextField(const char*& p,const char* eol,string& scratch){
+        if(p<eol&&*p=='"'){
+            scratch.clear();
+            p++;
+            while(p<eol){
+                if(*p=='"'){
+                    if(p+1<eol&&p[1]=='"'){ scratch+='"'; p+=2; continue; }
+                    p++;
+                    break;
+                }
+                scratch+=*p++;
+            }
+            while(p<eol&&*p!=',') p++;
+            if(p<eol) p++;
+            return string_view(scratch);
+        }
+        const char* start=p;
+        while(p<eol&&*p!=',') p++;
+        string_view field(start,p-start);
+        if(p<eol) p++;
+        return field;
+    }
+    template<typename T>
+    static bool parseNumber(string_view field,T& value){
+        field=trim(field);
+        if(field.empty()) return false;
+        auto res=from_chars(field.data(),field.data()+field.size(),value);
+        return res.ec==errc()&&res.ptr==field.data()+field.size();
+    }
+    static void parseChunk(Chunk& chunk){
+        string nameScratch, categoryScratch, unused;
+        const char* p=chunk.begin;
+        while(p<chunk.end){
+            const char* eol=(const char*)memchr(p,'\n',chunk.end-p);
+            if(!eol) eol=chunk.end;
+            chunk.lines++;
+            const char* lineEnd=eol;
+            if(lineEnd>p&&lineEnd[-1]=='\r') lineEnd--;
+            if(lineEnd>p){
+                int id=0, stock=0;
+                double price=0;
+                bool ok=parseNumber(nextField(p,lineEnd,unused),id);
+                string_view name=nextField(p,lineEnd,nameScratch);
+                ok=parseNumber(nextField(p,lineEnd,unused),price)&&ok;
+                ok=parseNumber(nextField(p,lineEnd,unused),stock)&&ok;
+                string_view category=trim(nextField(p,lineEnd,categoryScratch));
+                try{
+                    if(!ok) throw invalid_argument("malformed row");
+                    chunk.rows.emplace_back(id,string(name),price,stock,string(category));
+                } catch(const exception&){
+                    chunk.errorLine=chunk.lines;
+                    return;
+                }
+            }
+            p=eol+1;
+        }
+    }
+    vector<Chunk> chunks;
+public:
+    size_t rowCount;
+    double seconds;
+    ProductCsvParser() : rowCount(0), seconds(0) {}
+    /* parses the whole file; throws before anything is handed out if any row is malformed.
+       maxWorkers 0 uses every core */
+    void parse(const string& filename,int maxWorkers=0){
+        auto start=chrono::steady_clock::now();
+        MappedFile file(filename);
+        const char* p=file.begin();
+        const char* end=file.end();
+        const char* firstRow=p?(const char*)memchr(p,'\n',end-p):nullptr;
+        firstRow=firstRow?firstRow+1:end;
+        size_t bytes=end-firstRow;
+        int workers=(int)max(1u,thread::hardware_concurrency());
+        if(maxWorkers>0) workers=min(workers,maxWorkers);
+        if(bytes<(1u<<20)) workers=1;
+        chunks.assign(workers,Chunk());
+        const char* cut=firstRow;
+        for(int i=0;i<workers;i++){
+            chunks[i].begin=cut;
+            const char* next=(i==workers-1)?end:firstRow+bytes*(i+1)/workers;
+            if(next<cut) next=cut;
+            if(next<end){
+                const char* eol=(const char*)memchr(next,'\n',end-next);
+                next=eol?eol+1:end;
+            }
+            chunks[i].end=next;
+            cut=next;
+        }
+        if(workers==1) parseChunk(chunks[0]);
+        else{
+            vector<thread> pool;
+            for(auto& chunk:chunks) pool.emplace_back(parseChunk,ref(chunk));
+            for(auto& t:pool) t.join();
+        }
+        size_t lineBase=1;
+        for(auto& chunk:chunks){
+            if(chunk.errorLine)
+                throw FileOperationException("Malformed row at line "+to_string(lineBase+chunk.errorLine)+" of "+filename);
+            lineBase+=chunk.lines;
+        }
+        rowCount=0;
+        for(auto& chunk:chunks) rowCount+=chunk.rows.size();
+        seconds=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    }
+    /* moves the parsed products out in file order */
+    template<typename F>
+    void drain(F sink){
+        for(auto& chunk:chunks){
+            for(auto& product:chunk.rows) sink(move(product));
+            vector<Product>().swap(chunk.rows);
+        }
+    }
+};
+
+/* committed transaction header; its line items sit contiguously in the owning shard's item arena */
+struct TransactionRecord {
+    int32_t id;
+    int32_t cashierId;
+    int64_t timestamp; /* seconds since the epoch, formatted only for output */
+    Cents total;
+    uint32_t shard;
+    uint32_t firstItem;
+    uint32_t itemCount;
+    atomic<uint32_t> nextByCashier; /* index+1 of the same cashier's next record in this shard */
+};
+
+/* append-only transaction history. Each checkout lane appends to its own shard, where ids and
+   timestamps only grow, so id/time ranges are binary searches and cashier scans follow links.
+   Published records are never moved or copied; readers scan them without taking shard locks. */
+class TransactionJournal {
+public:
+    static const int SHARDS = 64;
+private:
+    struct Shard {
+        mutex lock;
+        ChunkedArray<TransactionRecord,14> records;
+        ChunkedArray<LineItem,16> items;
+        atomic<uint32_t> recordCount;
+        uint32_t itemCount;
+        int64_t lastTimestamp;
+        unordered_map<int,uint32_t> firstByCashier, lastByCashier;
+        Shard() : recordCount(0), itemCount(0), lastTimestamp(0) {}
+    };
+    vector<unique_ptr<Shard>> shards;
+    atomic<int> nextId;
+    struct Cursor {
+        int32_t id;
+        uint32_t shard, index;
+        bool operator<(const Cursor& o) const { return id>o.id; }
+    };
+    /* k-way merge of per-shard runs in transaction id order; start gives a shard's first index
+       (or count for none), advance its next index, and the scan stops at the first record for
+       which keep() is false */
+    template<typename Start,typename Advance,typename Keep,typename F>
+    void mergeScan(Start start,Advance advance,Keep keep,F visit) const {
+        vector<Cursor> heap;
+        for(uint32_t s=0;s<SHARDS;s++){
+            Shard& shard=*shards[s];
+            uint32_t count=shard.recordCount.load(memory_order_acquire);
+            uint32_t i=start(shard,count);
+            if(i<count&&keep(shard.records[i])) heap.push_back(Cursor{shard.records[i].id,s,i});
+        }
+        make_heap(heap.begin(),heap.end());
+        while(!heap.empty()){
+            pop_heap(heap.begin(),heap.end());
+            Cursor c=heap.back();
+            heap.pop_back();
+            Shard& shard=*shards[c.shard];
+            const TransactionRecord& rec=shard.records[c.index];
+            visit(rec);
+            uint32_t count=shard.recordCount.load(memory_order_acquire);
+            uint32_t next=advance(shard,rec,c.index);
+            if(next<count&&keep(shard.records[next])){
+                heap.push_back(Cursor{shard.records[next].id,c.shard,next});
+                push_heap(heap.begin(),heap.end());
+            }
+        }
+    }
+    template<typename Less>
+    static uint32_t lowerBound(Shard& shard,uint32_t count,Less less){
+        uint32_t lo=0, hi=count;
+        while(lo<hi){
+            uint32_t mid=lo+(hi-lo)/2;
+            if(less(shard.records[mid])) lo=mid+1; else hi=mid;
+        }
+        return lo;
+    }
+    static uint32_t nextInShard(Shard&,const TransactionRecord&,uint32_t index){ return index+1; }
+public:
+    TransactionJournal() : nextId(1) {
+        for(int i=0;i<SHARDS;i++) shards.emplace_back(new Shard());
+    }
+    int peekNextId() const { return nextId.load(); }
+    void reserveId(int id){
+        int current=nextId.load();
+        while(current<=id&&!nextId.compare_exchange_weak(current,id+1)) {}
+    }
+    struct NoHook { void operator()(const TransactionRecord&) const {} };
+    /* id 0 draws the next id and timestamp 0 means now; explicit values are used by recovery.
+       "now" never goes below the shard's previous record, so time-range scans can stop at the first
+       record past the range even if the wall clock is stepped back. published runs under the shard
+       lock, so anything it logs goes out in the shard's id order */
+    template<typename Hook=NoHook>
+    const TransactionRecord& append(int lane,int cashierId,const vector<LineItem>& lines,Cents total,
+                                    int id=0,int64_t timestamp=0,Hook published=Hook()){
+        uint32_t s=(unsigned)lane%SHARDS;
+        Shard& shard=*shards[s];
+        lock_guard<mutex> guard(shard.lock);
+        if(id==0) id=nextId.fetch_add(1,memory_order_relaxed);
+        else reserveId(id);
+        if(timestamp==0) timestamp=max((int64_t)time(0),shard.lastTimestamp);
+        shard.lastTimestamp=max(shard.lastTimestamp,timestamp);
+        uint32_t first=shard.itemCount;
+        shard.items.ensure((size_t)first+lines.size());
+        for(size_t i=0;i<lines.size();i++) shard.items[first+i]=lines[i];
+        shard.itemCount+=(uint32_t)lines.size();
+        uint32_t index=shard.recordCount.load(memory_order_relaxed);
+        shard.records.ensure((size_t)index+1);
+        TransactionRecord& rec=shard.records[index];
+        rec.id=id;
+        rec.cashierId=cashierId;
+        rec.timestamp=timestamp;
+        rec.total=total;
+        rec.shard=s;
+        rec.firstItem=first;
+        rec.itemCount=(uint32_t)lines.size();
+        rec.nextByCashier.store(0,memory_order_relaxed);
+        auto last=shard.lastByCashier.find(cashierId);
+        if(last!=shard.lastByCashier.end()){
+            shard.records[last->second].nextByCashier.store(index+1,memory_order_release);
+            last->second=index;
+        } else {
+            shard.firstByCashier[cashierId]=index;
+            shard.lastByCashier[cashierId]=index;
+        }
+        shard.recordCount.store(index+1,memory_order_release);
+        published(rec);
+        return rec;
+    }
+    const LineItem& item(const TransactionRecord& rec,uint32_t i) const {
+        return shards[rec.shard]->items[rec.firstItem+i];
+    }
+    size_t size() const {
+        size_t total=0;
+        for(auto& shard:shards) total+=shard->recordCount.load(memory_order_acquire);
+        return total;
+    }
+    bool empty() const { return size()==0; }
+    template<typename F>
+    void forEach(F visit) const { forEachInIdRange(INT32_MIN,INT32_MAX,visit); }
+    template<typename F>
+    void forEachInIdRange(int fromId,int toId,F visit) const {
+        mergeScan([fromId](Shard& shard,uint32_t count){
+                      return lowerBound(shard,count,[fromId](const TransactionRecord& r){ return r.id<fromId; });
+                  },
+                  nextInShard,
+                  [toId](const TransactionRecord& r){ return r.id<=toId; },visit);
+    }
+    template<typename F>
+    void forEachInTimeRange(int64_t from,int64_t to,F visit) const {
+        mergeScan([from](Shard& shard,uint32_t count){
+                      return lowerBound(shard,count,[from](const TransactionRecord& r){ return r.timestamp<from; });
+                  },
+                  nextInShard,
+                  [to](const TransactionRecord& r){ return r.timestamp<=to; },visit);
+    }
+    template<typename F>
+    void forEachByCashier(int cashierId,F visit) const {
+        mergeScan([cashierId](Shard& shard,uint32_t count){
+                      lock_guard<mutex> guard(shard.lock);
+                      auto it=shard.firstByCashier.find(cashierId);
+                      return it==shard.firstByCashier.end()?count:it->second;
+                  },
+                  [](Shard&,const TransactionRecord& rec,uint32_t){
+                      uint32_t next=rec.nextByCashier.load(memory_order_acquire);
+                      return next==0?UINT32_MAX:next-1;
+                  },
+                  [](const TransactionRecord&){ return true; },visit);
+    }
+};
+
+/* running sales totals, updated as items are sold and baskets commit so every report is a
+   lookup rather than a pass over the journal. Money is kept in integer cents. */
+class SalesAnalytics {
+public:
+    static const int TOP_CAPACITY = 32;
+    struct Totals {
+        int64_t units, revenueCents, transactions;
+    };
+    struct Ranked {
+        int id;
+        int64_t units, revenueCents;
+    };
+private:
+    ChunkedArray<atomic<int64_t>> productUnits, productRevenue;
+    ChunkedArray<int> productCategory;
+    int maxProductId;
+    mutex categoryLock;
+    unordered_map<string,int> categoryIds;
+    vector<string> categoryNames;
+    ChunkedArray<atomic<int64_t>,8> categoryUnits, categoryRevenue;
+    ChunkedArray<atomic<int64_t>,10> cashierRevenue, cashierTransactions;
+    int maxCashierId;
+    atomic<int64_t> hourRevenue[24], hourTransactions[24];
+    atomic<int64_t> totalRevenue, totalUnits, totalTransactions;
+    atomic<int64_t> firstSale;
+    long utcOffset;
+    /* best sellers: a small candidate set plus a threshold below which no sale needs the lock */
+    mutex topLock;
+    vector<int> topIds;
+    atomic<int64_t> topThreshold;
+    static void zero(atomic<int64_t>& counter){ counter.store(0,memory_order_relaxed); }
+    void refreshThreshold(){
+        int64_t low=INT64_MAX;
+        for(int id:topIds) low=min(low,productUnits[id].load(memory_order_relaxed));
+        topThreshold.store((int)topIds.size()<TOP_CAPACITY?0:low,memory_order_relaxed);
+    }
+    void offerBestSeller(int productId,int64_t units){
+        lock_guard<mutex> guard(topLock);
+        for(int id:topIds){
+            if(id==productId){ refreshThreshold(); return; }
+        }
+        if((int)topIds.size()<TOP_CAPACITY) topIds.push_back(productId);
+        else{
+            size_t weakest=0;
+            for(size_t i=1;i<topIds.size();i++)
+                if(productUnits[topIds[i]].load(memory_order_relaxed)<productUnits[topIds[weakest]].load(memory_order_relaxed))
+                    weakest=i;
+            if(productUnits[topIds[weakest]].load(memory_order_relaxed)>=units) return;
+            topIds[weakest]=productId;
+        }
+        refreshThreshold();
+    }
+public:
+    SalesAnalytics()
+        : maxProductId(-1), maxCashierId(-1), totalRevenue(0), totalUnits(0), totalTransactions(0), firstSale(INT64_MAX), topThreshold(0) {
+        for(int h=0;h<24;h++){ zero(hourRevenue[h]); zero(hourTransactions[h]); }
+        time_t now=time(0);
+        struct tm local;
+        localtime_r(&now,&local);
+        utcOffset=local.tm_gmtoff; /* fixed at start-up; a DST switch mid-run shifts buckets by an hour */
+    }
+    /* products and cashiers are registered from the menu or loaders, never during checkout */
+    void registerProduct(int id,const string& category){
+        if(id<0) return;
+        int cat;
+        {
+            lock_guard<mutex> guard(categoryLock);
+            auto it=categoryIds.find(category);
+            if(it==categoryIds.end()){
+                cat=(int)categoryNames.size();
+                categoryIds[category]=cat;
+                categoryNames.push_back(category);
+                categoryUnits.ensure(cat+1); categoryRevenue.ensure(cat+1);
+                zero(categoryUnits[cat]); zero(categoryRevenue[cat]);
+            } else cat=it->second;
+        }
+        if(id>maxProductId){
+            size_t old=productUnits.capacity();
+            productUnits.ensure((size_t)id+1); productRevenue.ensure((size_t)id+1);
+            productCategory.ensure((size_t)id+1,-1);
+            for(size_t i=old;i<productUnits.capacity();i++){ zero(productUnits[i]); zero(productRevenue[i]); }
+            maxProductId=id;
+        }
+        productCategory[id]=cat;
+    }
+    void registerCashier(int id){
+        if(id<0||id<=maxCashierId) return;
+        size_t old=cashierRevenue.capacity();
+        cashierRevenue.ensure((size_t)id+1); cashierTransactions.ensure((size_t)id+1);
+        for(size_t i=old;i<cashierRevenue.capacity();i++){ zero(cashierRevenue[i]); zero(cashierTransactions[i]); }
+        maxCashierId=id;
+    }
+    void recordItem(int productId,int quantity,Cents unitPrice){
+        if(productId<0||productId>maxProductId) return;
+        int64_t cents=unitPrice*quantity;
+        int64_t units=productUnits[productId].fetch_add(quantity,memory_order_relaxed)+quantity;
+        productRevenue[productId].fetch_add(cents,memory_order_relaxed);
+        int cat=productCategory[productId];
+        if(cat>=0){
+            categoryUnits[cat].fetch_add(quantity,memory_order_relaxed);
+            categoryRevenue[cat].fetch_add(cents,memory_order_relaxed);
+        }
+        totalUnits.fetch_add(quantity,memory_order_relaxed);
+        if(units>topThreshold.load(memory_order_relaxed)) offerBestSeller(productId,units);
+    }
+    /* promotion savings are settled at commit, after the items were counted at full price */
+    void recordDiscount(int productId,Cents discount){
+        if(productId<0||productId>maxProductId) return;
+        productRevenue[productId].fetch_sub(discount,memory_order_relaxed);
+        int cat=productCategory[productId];
+        if(cat>=0) categoryRevenue[cat].fetch_sub(discount,memory_order_relaxed);
+    }
+    void recordTransaction(int cashierId,int64_t timestamp,Cents total){
+        int64_t cents=total;
+        int hour=(int)((((timestamp+utcOffset)/3600)%24+24)%24);
+        hourRevenue[hour].fetch_add(cents,memory_order_relaxed);
+        hourTransactions[hour].fetch_add(1,memory_order_relaxed);
+        if(cashierId>=0&&cashierId<=maxCashierId){
+            cashierRevenue[cashierId].fetch_add(cents,memory_order_relaxed);
+            cashierTransactions[cashierId].fetch_add(1,memory_order_relaxed);
+        }
+        totalRevenue.fetch_add(cents,memory_order_relaxed);
+        totalTransactions.fetch_add(1,memory_order_relaxed);
+        int64_t first=firstSale.load(memory_order_relaxed);
+        while(timestamp<first&&!firstSale.compare_exchange_weak(first,timestamp,memory_order_relaxed)){}
+    }
+    /* -1 until the first sale */
+    int64_t firstSaleTime() const {
+        int64_t first=firstSale.load(memory_order_relaxed);
+        return first==INT64_MAX?-1:first;
+    }
+    Totals product(int id) const {
+        if(id<0||id>maxProductId) return Totals{0,0,0};
+        return Totals{productUnits[id].load(memory_order_relaxed),productRevenue[id].load(memory_order_relaxed),0};
+    }
+    Totals cashier(int id) const {
+        if(id<0||id>maxCashierId) return Totals{0,0,0};
+        return Totals{0,cashierRevenue[id].load(memory_order_relaxed),cashierTransactions[id].load(memory_order_relaxed)};
+    }
+    Totals hour(int h) const {
+        return Totals{0,hourRevenue[h].load(memory_order_relaxed),hourTransactions[h].load(memory_order_relaxed)};
+    }
+    Totals overall() const {
+        return Totals{totalUnits.load(memory_order_relaxed),totalRevenue.load(memory_order_relaxed),
+                      totalTransactions.load(memory_order_relaxed)};
+    }
+    /* per category, id is the index into categories() */
+    vector<Ranked> byCategory(){
+        lock_guard<mutex> guard(categoryLock);
+        vector<Ranked> out;
+        for(size_t c=0;c<categoryNames.size();c++)
+            out.push_back(Ranked{(int)c,categoryUnits[c].load(memory_order_relaxed),categoryRevenue[c].load(memory_order_relaxed)});
+        return out;
+    }
+    string categoryName(int id){
+        lock_guard<mutex> guard(categoryLock);
+        return id>=0&&id<(int)categoryNames.size()?categoryNames[id]:"";
+    }
+    /* O(TOP_CAPACITY log TOP_CAPACITY) regardless of catalog size or history length */
+    vector<Ranked> topSellers(int n){
+        vector<Ranked> out;
+        {
+            lock_guard<mutex> guard(topLock);
+            for(int id:topIds) out.push_back(Ranked{id,productUnits[id].load(memory_order_relaxed),productRevenue[id].load(memory_order_relaxed)});
+        }
+        sort(out.begin(),out.end(),[](const Ranked& a,const Ranked& b){ return a.units>b.units||(a.units==b.units&&a.id<b.id); });
+        if((int)out.size()>n) out.resize(max(0,n));
+        return out;
+    }
+};
+
+/* products whose stock is below their reorder threshold. Stock changes only touch the set when they
+   cross a threshold, so listing what to reorder costs time proportional to the answer. */
+class LowStockIndex {
+public:
+    static const int DEFAULT_THRESHOLD = 20;
+    struct Override {
+        int productId; /* -1 for a category-wide threshold */
+        string category;
+        int threshold;
+    };
+private:
+    ChunkedArray<int> threshold, position; /* position in members, -1 when stocked */
+    ChunkedArray<uint8_t> overridden;
+    int maxProductId;
+    mutex lock;
+    vector<int> members;
+    unordered_map<string,int> categoryThresholds;
+    /* membership follows the stock read under the lock, so racing crossings settle on the last one */
+    void sync(const Product& p){
+        int id=p.getId();
+        lock_guard<mutex> guard(lock);
+        bool low=p.getStock()<threshold[id];
+        int& pos=position[id];
+        if(low&&pos<0){
+            pos=(int)members.size();
+            members.push_back(id);
+        } else if(!low&&pos>=0){
+            int last=members.back();
+            members[pos]=last;
+            position[last]=pos;
+            members.pop_back();
+            pos=-1;
+        }
+    }
+public:
+    LowStockIndex() : maxProductId(-1) {}
+    /* products and thresholds are set up from the menu or loaders, never during checkout */
+    void registerProduct(const Product& p){
+        int id=p.getId();
+        if(id<0) return;
+        if(id>maxProductId){
+            threshold.ensure((size_t)id+1,DEFAULT_THRESHOLD);
+            position.ensure((size_t)id+1,-1);
+            overridden.ensure((size_t)id+1,0);
+            maxProductId=id;
+        }
+        if(!overridden[id]){
+            auto it=categoryThresholds.find(p.getCategory());
+            threshold[id]=it==categoryThresholds.end()?DEFAULT_THRESHOLD:it->second;
+        }
+        sync(p);
+    }
+    void stockChanged(const Product& p,int before,int after){
+        int id=p.getId();
+        if(id<0||id>maxProductId) return;
+        int t=threshold[id];
+        if((before<t)!=(after<t)) sync(p);
+    }
+    int thresholdOf(int id) const { return id<0||id>maxProductId?DEFAULT_THRESHOLD:threshold[id]; }
+    void setProductThreshold(const Product& p,int value){
+        if(value<0) throw InvalidQuantityException();
+        int id=p.getId();
+        if(id<0||id>maxProductId) throw ProductNotFoundException();
+        threshold[id]=value;
+        overridden[id]=1;
+        sync(p);
+    }
+    /* products with their own threshold keep it */
+    void setCategoryThreshold(const string& category,int value,ProductStore& products){
+        if(value<0) throw InvalidQuantityException();
+        categoryThresholds[category]=value;
+        products.forEach([this,&category,value](Product& p){
+            if(p.getCategory()!=category||overridden[p.getId()]) return;
+            threshold[p.getId()]=value;
+            sync(p);
+        });
+    }
+    vector<Override> overrides() const {
+        vector<Override> out;
+        for(auto& c:categoryThresholds) out.push_back(Override{-1,c.first,c.second});
+        for(int id=0;id<=maxProductId;id++)
+            if(overridden[id]) out.push_back(Override{id,"",threshold[id]});
+        return out;
+    }
+    size_t size(){
+        lock_guard<mutex> guard(lock);
+        return members.size();
+    }
+    vector<int> lowProducts(){
+        lock_guard<mutex> guard(lock);
+        return members;
+    }
+};
+
+/* name/category search. Text is folded to lowercase ASCII (Azerbaijani and Latin-1 letters lose their
+   marks, so "seker" finds "Şəkər") and cut into tokens, each with an id-sorted posting list.
+   Prefixes walk an ordered token dictionary; typos go through a trigram index over the dictionary
+   and are confirmed with a bounded edit distance. A product must match every term; it scores the
+   best way each term reached it, and results rank by score, then by id. */
+class ProductSearchIndex {
+public:
+    static const size_t MAX_PREFIX_TOKENS = 64;
+    struct Match {
+        int productId;
+        int score;
+    };
+private:
+    enum Weight { NAME_EXACT = 100, NAME_PREFIX = 70, NAME_FUZZY = 50, CATEGORY_EXACT = 40, CATEGORY_PREFIX = 30, CATEGORY_FUZZY = 20 };
+    struct Token {
+        const string* text;
+        vector<int32_t> names, categories;
+    };
+    /* one posting list a term reaches, with a cursor that only moves forward */
+    struct Source {
+        const vector<int32_t>* list;
+        int weight;
+        size_t pos;
+    };
+    struct Term {
+        vector<Source> sources;
+        size_t postings;
+        int bestWeight;
+    };
+    /* per-thread trigram counters for the fuzzy pass, reset by bumping a stamp */
+    struct Scratch {
+        vector<uint32_t> seen;
+        vector<uint16_t> shared;
+        vector<uint32_t> touched;
+        uint32_t stamp;
+        Scratch() : stamp(0) {}
+        void begin(size_t tokenCount){
+            if(++stamp==0){ fill(seen.begin(),seen.end(),0); stamp=1; }
+            if(seen.size()<tokenCount){ seen.resize(tokenCount,0); shared.resize(tokenCount); }
+            touched.clear();
+        }
+    };
+    vector<Token> tokens;
+    map<string,uint32_t> dictionary;
+    unordered_map<uint32_t,vector<uint32_t>> trigrams; /* three token bytes -> tokens containing them */
+    mutable shared_mutex lock;
+    static Scratch& scratch(){
+        thread_local Scratch s;
+        return s;
+    }
+    /* folds one code point onto out; returns false for separators */
+    static bool fold(uint32_t cp,string& out){
+        /* Latin-1 0xC0..0xFF, '*' marks the multiplication and division signs */
+        static const char LATIN1[]="aaaaaaaceeeeiiiidnooooo*ouuuuytsaaaaaaaceeeeiiiidnooooo*ouuuuyty";
+        if(cp<128){
+            if(isalnum((int)cp)){ out+=(char)tolower((int)cp); return true; }
+            return false;
+        }
+        if(cp>=0xC0&&cp<=0xFF){
+            char c=LATIN1[cp-0xC0];
+            if(c=='*') return false;
+            out+=c;
+            return true;
+        }
+        switch(cp){
+            case 0x11E: case 0x11F: out+='g'; return true;  /* Ğ ğ */
+            case 0x130: case 0x131: out+='i'; return true;  /* İ ı */
+            case 0x15E: case 0x15F: out+='s'; return true;  /* Ş ş */
+            case 0x18F: case 0x259: out+='e'; return true;  /* Ə ə */
+        }
+        if(cp<0xC0||(cp>=0x2000&&cp<0x2070)) return false; /* Latin-1 symbols, general punctuation */
+        char utf8[4];
+        int n=cp<0x800?2:(cp<0x10000?3:4);
+        for(int i=n-1;i>0;i--){ utf8[i]=(char)(0x80|(cp&0x3F)); cp>>=6; }
+        utf8[0]=(char)((n==2?0xC0:(n==3?0xE0:0xF0))|cp);
+        out.append(utf8,n);
+        return true;
+    }
+    /* distinct folded tokens of text, in order of appearance */
+    static vector<string> tokenize(const string& text){
+        vector<string> out;
+        string current;
+        auto finish=[&out,&current](){
+            if(!current.empty()&&find(out.begin(),out.end(),current)==out.end()) out.push_back(current);
+            current.clear();
+        };
+        for(size_t i=0;i<text.size();){
+            unsigned char c=(unsigned char)text[i];
+            int n=c<0x80?1:((c>>5)==6?2:((c>>4)==14?3:((c>>3)==30?4:0)));
+            uint32_t cp=n==1?c:(n==2?c&0x1F:(n==3?c&0x0F:c&0x07));
+            bool valid=n>0&&i+n<=text.size();
+            for(int k=1;valid&&k<n;k++){
+                unsigned char cont=(unsigned char)text[i+k];
+                if((cont&0xC0)!=0x80) valid=false;
+                cp=cp<<6|(cont&0x3F);
+            }
+            if(!valid){ finish(); i++; continue; }
+            if(!fold(cp,current)) finish();
+            i+=n;
+        }
+        finish();
+        return out;
+    }
+    static uint32_t trigramKey(const string& padded,size_t i){
+        return (uint32_t)(unsigned char)padded[i]<<16|(uint32_t)(unsigned char)padded[i+1]<<8|(unsigned char)padded[i+2];
+    }
+    /* token padded with one boundary byte each side gives size() trigrams */
+    static string padded(const string& token){ return "\x01"+token+"\x02"; }
+    uint32_t tokenId(const string& text){
+        auto it=dictionary.find(text);
+        if(it!=dictionary.end()) return it->second;
+        uint32_t id=(uint32_t)tokens.size();
+        it=dictionary.emplace(text,id).first;
+        tokens.push_back(Token{&it->first,{},{}});
+        string p=padded(text);
+        for(size_t i=0;i+3<=p.size();i++){
+            vector<uint32_t>& list=trigrams[trigramKey(p,i)];
+            if(list.empty()||list.back()!=id) list.push_back(id);
+        }
+        return id;
+    }
+    /* ids mostly arrive in ascending order, so keeping the lists sorted is an append */
+    static void insertSorted(vector<int32_t>& list,int32_t id){
+        if(list.empty()||list.back()<id){ list.push_back(id); return; }
+        auto it=lower_bound(list.begin(),list.end(),id);
+        if(*it!=id) list.insert(it,id);
+    }
+    static void eraseSorted(vector<int32_t>& list,int32_t id){
+        auto it=lower_bound(list.begin(),list.end(),id);
+        if(it!=list.end()&&*it==id) list.erase(it);
+    }
+    /* Levenshtein distance, or bound+1 as soon as it must exceed bound */
+    static int editDistance(const string& a,const string& b,int bound){
+        if(abs((int)a.size()-(int)b.size())>bound) return bound+1;
+        vector<int> row(b.size()+1);
+        for(size_t j=0;j<=b.size();j++) row[j]=(int)j;
+        for(size_t i=1;i<=a.size();i++){
+            int diagonal=row[0], lowest=row[0]=(int)i;
+            for(size_t j=1;j<=b.size();j++){
+                int above=row[j];
+                row[j]=min(min(row[j]+1,row[j-1]+1),diagonal+(a[i-1]!=b[j-1]));
+                diagonal=above;
+                lowest=min(lowest,row[j]);
+            }
+            if(lowest>bound) return bound+1;
+        }
+        return row[b.size()];
+    }
+    static void addSource(Term& term,const vector<int32_t>& list,int weight){
+        if(list.empty()) return;
+        term.sources.push_back(Source{&list,weight,0});
+        term.postings+=list.size();
+        term.bestWeight=max(term.bestWeight,weight);
+    }
+    void addToken(Term& term,uint32_t token,int nameWeight,int categoryWeight) const {
+        addSource(term,tokens[token].names,nameWeight);
+        addSource(term,tokens[token].categories,categoryWeight);
+    }
+    /* posting lists one query term reaches: its exact token, up to MAX_PREFIX_TOKENS completions and
+       its near misses (one edit from 4 letters, two from 7) */
+    Term expand(const string& text) const {
+        Term term{{},0,0};
+        auto exact=dictionary.find(text);
+        if(exact!=dictionary.end()) addToken(term,exact->second,NAME_EXACT,CATEGORY_EXACT);
+        size_t expanded=0;
+        for(auto it=dictionary.upper_bound(text);it!=dictionary.end()&&expanded<MAX_PREFIX_TOKENS;++it,++expanded){
+            if(it->first.compare(0,text.size(),text)!=0) break;
+            addToken(term,it->second,NAME_PREFIX,CATEGORY_PREFIX);
+        }
+        if(text.size()<4) return term;
+        int bound=text.size()>=7?2:1;
+        Scratch& s=scratch();
+        s.begin(tokens.size());
+        string p=padded(text);
+        for(size_t i=0;i+3<=p.size();i++){
+            auto list=trigrams.find(trigramKey(p,i));
+            if(list==trigrams.end()) continue;
+            for(uint32_t t:list->second){
+                if(s.seen[t]!=s.stamp){ s.seen[t]=s.stamp; s.shared[t]=0; s.touched.push_back(t); }
+                s.shared[t]++;
+            }
+        }
+        /* each edit destroys at most three of the term's trigrams */
+        int needed=(int)text.size()-3*bound;
+        for(uint32_t t:s.touched){
+            const string& candidate=*tokens[t].text;
+            if(s.shared[t]<needed||candidate==text||candidate.compare(0,text.size(),text)==0) continue;
+            int distance=editDistance(text,candidate,bound);
+            if(distance<=bound) addToken(term,t,NAME_FUZZY-10*distance,CATEGORY_FUZZY-5*distance);
+        }
+        return term;
+    }
+    /* best weight among the term's lists that contain id; ids must be asked in ascending order */
+    static int weightOf(Term& term,int32_t id){
+        int best=0;
+        for(auto& src:term.sources){
+            const vector<int32_t>& list=*src.list;
+            size_t step=1, hi=src.pos;
+            while(hi<list.size()&&list[hi]<id){ src.pos=hi+1; hi+=step; step<<=1; }
+            src.pos=lower_bound(list.begin()+src.pos,list.begin()+min(hi+1,list.size()),id)-list.begin();
+            if(src.pos<list.size()&&list[src.pos]==id) best=max(best,src.weight);
+        }
+        return best;
+    }
+    /* walks the rarest term's lists in id order and probes the others; since later ids lose ties,
+       the walk stops once limit products reach the highest score any product could get */
+    vector<Match> intersect(vector<Term>& terms,size_t limit) const {
+        size_t driver=0;
+        int ceiling=0;
+        for(size_t t=0;t<terms.size();t++){
+            if(terms[t].postings<terms[driver].postings) driver=t;
+            ceiling+=terms[t].bestWeight;
+        }
+        typedef pair<int32_t,uint32_t> Head; /* next id, source */
+        priority_queue<Head,vector<Head>,greater<Head>> heads;
+        vector<Source>& lead=terms[driver].sources;
+        for(uint32_t i=0;i<lead.size();i++) heads.push(Head{(*lead[i].list)[0],i});
+        auto worse=[](const Match& a,const Match& b){ return a.score>b.score||(a.score==b.score&&a.productId<b.productId); };
+        vector<Match> top; /* heap with the weakest kept match in front */
+        size_t perfect=0;
+        while(!heads.empty()&&perfect<limit){
+            int32_t id=heads.top().first;
+            int score=0;
+            while(!heads.empty()&&heads.top().first==id){
+                Source& src=lead[heads.top().second];
+                heads.pop();
+                score=max(score,src.weight);
+                if(++src.pos<src.list->size()) heads.push(Head{(*src.list)[src.pos],(uint32_t)(&src-&lead[0])});
+            }
+            for(size_t t=0;t<terms.size()&&score>0;t++){
+                if(t==driver) continue;
+                int w=weightOf(terms[t],id);
+                score=w?score+w:0;
+            }
+            if(score==0) continue;
+            Match m{id,score};
+            if(top.size()<limit){ top.push_back(m); push_heap(top.begin(),top.end(),worse); }
+            else if(worse(m,top.front())){
+                if(top.front().score==ceiling) perfect--;
+                pop_heap(top.begin(),top.end(),worse);
+                top.back()=m;
+                push_heap(top.begin(),top.end(),worse);
+            } else continue;
+            if(score==ceiling) perfect++;
+        }
+        sort_heap(top.begin(),top.end(),worse);
+        return top;
+    }
+public:
+    ProductSearchIndex() {}
+    ProductSearchIndex(const ProductSearchIndex&) = delete;
+    ProductSearchIndex& operator=(const ProductSearchIndex&) = delete;
+    /* products change from the menu or loaders; searches may run meanwhile */
+    void add(const Product& p){
+        int id=p.getId();
+        if(id<0) return;
+        vector<string> name=tokenize(p.getName()), category=tokenize(p.getCategory());
+        unique_lock<shared_mutex> guard(lock);
+        for(auto& t:name) insertSorted(tokens[tokenId(t)].names,id);
+        for(auto& t:category) insertSorted(tokens[tokenId(t)].categories,id);
+    }
+    void remove(const Product& p){
+        vector<string> name=tokenize(p.getName()), category=tokenize(p.getCategory());
+        unique_lock<shared_mutex> guard(lock);
+        for(auto& t:name){
+            auto it=dictionary.find(t);
+            if(it!=dictionary.end()) eraseSorted(tokens[it->second].names,p.getId());
+        }
+        for(auto& t:category){
+            auto it=dictionary.find(t);
+            if(it!=dictionary.end()) eraseSorted(tokens[it->second].categories,p.getId());
+        }
+    }
+    size_t tokenCount() const {
+        shared_lock<shared_mutex> guard(lock);
+        return tokens.size();
+    }
+    /* terms that reach no token are ignored; when the rest share no product, trailing terms are
+       dropped one at a time, since the last word typed is the one most likely unfinished */
+    vector<Match> search(const string& query,size_t limit) const {
+        vector<string> words=tokenize(query);
+        if(words.empty()||limit==0) return vector<Match>();
+        STAT_SCOPE(STAT_SEARCH);
+        shared_lock<shared_mutex> guard(lock);
+        vector<Term> terms;
+        for(auto& word:words){
+            Term term=expand(word);
+            if(!term.sources.empty()) terms.push_back(move(term));
+        }
+        while(!terms.empty()){
+            vector<Match> found=intersect(terms,limit);
+            if(!found.empty()||terms.size()==1) return found;
+            terms.pop_back();
+            for(auto& term:terms) for(auto& src:term.sources) src.pos=0;
+        }
+        return vector<Match>();
+    }
+};
+
+/* little helpers for the native-endian binary formats of the snapshot and the write-ahead log */
+class BinaryWriter {
+public:
+    string buffer;
+    template<typename T>
+    void put(T value){ buffer.append((const char*)&value,sizeof(T)); }
+    void putString(const string& value){
+        put<uint32_t>((uint32_t)value.size());
+        buffer+=value;
+    }
+};
+
+class BinaryReader {
+private:
+    const char* p;
+    const char* end;
+public:
+    BinaryReader(const char* begin,const char* finish) : p(begin), end(finish) {}
+    template<typename T>
+    T get(){
+        if((size_t)(end-p)<sizeof(T)) throw FileOperationException("Truncated storage record");
+        T value;
+        memcpy(&value,p,sizeof(T));
+        p+=sizeof(T);
+        return value;
+    }
+    string getString(){
+        uint32_t n=get<uint32_t>();
+        if((size_t)(end-p)<n) throw FileOperationException("Truncated storage record");
+        string value(p,n);
+        p+=n;
+        return value;
+    }
+    bool atEnd() const { return p>=end; }
+};
+
+/* byte-level building blocks of the columnar sales format: LEB128 varints, zigzag for signed deltas
+   and an LZ77 block compressor (sequences of <literal count, literals, match length, distance>) */
+class ColumnCodec {
+public:
+    static uint64_t zigzag(int64_t v){ return ((uint64_t)v<<1)^(uint64_t)(v>>63); }
+    static int64_t unzigzag(uint64_t v){ return (int64_t)(v>>1)^-(int64_t)(v&1); }
+    static void putVarint(string& out,uint64_t v){
+        while(v>=0x80){ out+=(char)(v|0x80); v>>=7; }
+        out+=(char)v;
+    }
+    static uint64_t getVarint(const char*& p,const char* end){
+        if(end-p>=2){ /* nearly every value in a sales column fits one or two bytes */
+            uint8_t b0=(uint8_t)p[0], b1=(uint8_t)p[1];
+            if(b0<0x80){ p++; return b0; }
+            if(b1<0x80){ p+=2; return (uint64_t)(b0&0x7f)|(uint64_t)b1<<7; }
+        }
+        return getLongVarint(p,end);
+    }
+    static uint64_t getLongVarint(const char*& p,const char* end){
+        uint64_t v=0;
+        for(int shift=0;shift<64;shift+=7){
+            if(p>=end) throw FileOperationException("Truncated sales column");
+            uint8_t b=(uint8_t)*p++;
+            v|=(uint64_t)(b&0x7f)<<shift;
+            if(b<0x80) return v;
+        }
+        throw FileOperationException("Corrupt sales column");
+    }
+    static const size_t MIN_MATCH=4, WINDOW=65535, HASH_BITS=14;
+    static string compress(const string& in){
+        string out;
+        vector<uint32_t> head((size_t)1<<HASH_BITS,UINT32_MAX);
+        const char* s=in.data();
+        size_t n=in.size(), literal=0, i=0;
+        auto hash=[s](size_t at){ uint32_t v; memcpy(&v,s+at,4); return (v*2654435761u)>>(32-HASH_BITS); };
+        while(i+MIN_MATCH<=n){
+            uint32_t h=hash(i), candidate=head[h];
+            head[h]=(uint32_t)i;
+            if(candidate!=UINT32_MAX&&i-candidate<=WINDOW&&memcmp(s+candidate,s+i,MIN_MATCH)==0){
+                size_t length=MIN_MATCH;
+                while(i+length<n&&s[candidate+length]==s[i+length]) length++;
+                putVarint(out,i-literal);
+                out.append(s+literal,i-literal);
+                putVarint(out,length-MIN_MATCH);
+                putVarint(out,i-candidate);
+                for(size_t j=i+1;j<i+length&&j+MIN_MATCH<=n;j+=2) head[hash(j)]=(uint32_t)j; /* every other position is enough */
+                i+=length;
+                literal=i;
+            } else i++;
+        }
+        putVarint(out,n-literal); /* the last sequence is literals only */
+        out.append(s+literal,n-literal);
+        return out;
+    }
+    static void decompress(const char* p,const char* end,size_t rawSize,string& out){
+        out.resize(rawSize);
+        char* o=&out[0];
+        size_t at=0;
+        while(true){
+            uint64_t literals=getVarint(p,end);
+            if(literals>(uint64_t)(end-p)||literals>rawSize-at) throw FileOperationException("Corrupt sales block");
+            memcpy(o+at,p,literals);
+            p+=literals; at+=literals;
+            if(at==rawSize) return;
+            uint64_t length=getVarint(p,end)+MIN_MATCH, distance=getVarint(p,end);
+            if(distance==0||distance>at||length>rawSize-at) throw FileOperationException("Corrupt sales block");
+            const char* from=o+at-distance;
+            for(uint64_t done=0;done<length;){ /* an overlapping match repeats its last distance bytes */
+                uint64_t step=min(length-done,distance);
+                memcpy(o+at+done,from+done,step);
+                done+=step;
+            }
+            at+=length;
+        }
+    }
+};
+
+/* bit per column, for choosing what a scan decodes */
+enum SalesColumn : unsigned { SALES_TRANSACTION = 1, SALES_TIME = 2, SALES_CASHIER = 4, SALES_PRODUCT = 8,
+                              SALES_QUANTITY = 16, SALES_PRICE = 32, SALES_ALL = 63 };
+
+/* One row per sold line, cut into blocks of BLOCK_ROWS. Each block starts with its row count, the
+   time span it covers and the raw/stored size of its six columns, then the columns themselves.
+   Transaction ids and timestamps are zigzag varint deltas, each followed by how many rows repeat
+   it; cashiers (runs again) and products are codes into a sorted per-block dictionary; quantities
+   are runs too. Product codes and unit cents are packed at a fixed width above the block minimum,
+   so scanning them has no per-value branches. A column is LZ-compressed when that saves a quarter. Blocks are
+   written as they fill, so exporting keeps one block in memory whatever the history size. */
+class SalesColumnWriter {
+public:
+    static const size_t BLOCK_ROWS = 65536;
+    static const int COLUMNS = 6;
+    static constexpr char MAGIC[8] = {'S','T','X','C','O','L','1','\n'};
+private:
+    ofstream out;
+    string path;
+    vector<int32_t> transactionIds, cashierIds, productIds, quantities;
+    vector<int64_t> timestamps;
+    vector<Cents> unitPrices;
+    size_t rows, bytes;
+    template<typename T>
+    static void putValues(string& out,const vector<T>& values,bool delta,bool runs){
+        int64_t previous=0;
+        for(size_t i=0;i<values.size();){
+            size_t n=1;
+            if(runs) while(i+n<values.size()&&values[i+n]==values[i]) n++;
+            ColumnCodec::putVarint(out,ColumnCodec::zigzag((int64_t)values[i]-previous));
+            if(runs) ColumnCodec::putVarint(out,n);
+            if(delta) previous=values[i];
+            i+=n;
+        }
+    }
+    /* offsets from the smallest value, each in the fewest whole bytes that fit them all */
+    template<typename T>
+    static void putPacked(string& out,const vector<T>& values){
+        int64_t low=*min_element(values.begin(),values.end()), high=*max_element(values.begin(),values.end());
+        uint64_t span=(uint64_t)(high-low);
+        int width=span<0x100?1:span<0x10000?2:span<0x100000000ull?4:8;
+        ColumnCodec::putVarint(out,ColumnCodec::zigzag(low));
+        out+=(char)width;
+        for(T v:values){
+            uint64_t offset=(uint64_t)((int64_t)v-low);
+            out.append((const char*)&offset,width); /* native little-endian, like the snapshot */
+        }
+    }
+    static void putDictionary(string& out,const vector<int32_t>& values,bool runs){
+        vector<int32_t> keys(values);
+        sort(keys.begin(),keys.end());
+        keys.erase(unique(keys.begin(),keys.end()),keys.end());
+        ColumnCodec::putVarint(out,keys.size());
+        putValues(out,keys,true,false);
+        unordered_map<int32_t,uint32_t> code;
+        code.reserve(keys.size());
+        for(size_t i=0;i<keys.size();i++) code[keys[i]]=(uint32_t)i;
+        vector<uint32_t> codes(values.size());
+        for(size_t i=0;i<values.size();i++) codes[i]=code[values[i]];
+        if(runs) putValues(out,codes,false,true);
+        else putPacked(out,codes);
+    }
+    void writeBlock(){
+        if(rows==0) return;
+        string raw[COLUMNS];
+        putValues(raw[0],transactionIds,true,true);
+        putValues(raw[1],timestamps,true,true);
+        putDictionary(raw[2],cashierIds,true);
+        putDictionary(raw[3],productIds,false);
+        putValues(raw[4],quantities,false,true);
+        putPacked(raw[5],unitPrices);
+        BinaryWriter block;
+        block.put<uint32_t>((uint32_t)rows);
+        block.put<int64_t>(*min_element(timestamps.begin(),timestamps.end()));
+        block.put<int64_t>(*max_element(timestamps.begin(),timestamps.end()));
+        string stored[COLUMNS];
+        for(int c=0;c<COLUMNS;c++){
+            stored[c]=ColumnCodec::compress(raw[c]);
+            if(stored[c].size()>raw[c].size()-raw[c].size()/4) stored[c]=raw[c]; /* kept as is: equal sizes say so */
+            block.put<uint32_t>((uint32_t)raw[c].size());
+            block.put<uint32_t>((uint32_t)stored[c].size());
+        }
+        for(auto& column:stored) block.buffer+=column;
+        out.write(block.buffer.data(),block.buffer.size());
+        if(!out) throw FileOperationException("Cannot write "+path);
+        bytes+=block.buffer.size();
+        transactionIds.clear(); timestamps.clear(); cashierIds.clear();
+        productIds.clear(); quantities.clear(); unitPrices.clear();
+        rows=0;
+    }
+public:
+    explicit SalesColumnWriter(const string& filename) : out(filename,ios::binary), path(filename), rows(0), bytes(0) {
+        if(!out) throw FileOperationException("Cannot open "+filename);
+        out.write(MAGIC,sizeof(MAGIC));
+        bytes=sizeof(MAGIC);
+    }
+    ~SalesColumnWriter(){
+        try{ close(); } catch(const exception&){}
+    }
+    void add(const TransactionRecord& rec,const LineItem& line){
+        transactionIds.push_back(rec.id);
+        timestamps.push_back(rec.timestamp);
+        cashierIds.push_back(rec.cashierId);
+        productIds.push_back(line.productId);
+        quantities.push_back(line.quantity);
+        unitPrices.push_back(line.unitPrice);
+        if(++rows==BLOCK_ROWS) writeBlock();
+    }
+    void close(){
+        if(!out.is_open()) return;
+        writeBlock();
+        out.close();
+        if(!out) throw FileOperationException("Cannot write "+path);
+    }
+    size_t bytesWritten() const { return bytes; }
+};
+
+/* reads a sales export back, decoding only the columns asked for. A time range skips whole blocks
+   on their header and trims the rest, so visitors only ever see matching rows */
+class SalesColumnReader {
+public:
+    struct Block {
+        size_t rows;
+        vector<int32_t> transactionIds, cashierIds, productIds, quantities;
+        vector<int64_t> timestamps;
+        vector<Cents> unitPrices;
+    };
+private:
+    static const size_t HEADER = 4+8+8+SalesColumnWriter::COLUMNS*8;
+    MappedFile file;
+    string scratch;
+    vector<int32_t> keys;
+    vector<uint32_t> codes;
+    template<typename T>
+    static void getValues(const char*& p,const char* end,size_t n,vector<T>& values,bool delta,bool runs){
+        values.resize(n);
+        int64_t previous=0;
+        for(size_t i=0;i<n;){
+            int64_t v=ColumnCodec::unzigzag(ColumnCodec::getVarint(p,end))+previous;
+            if(!runs){ values[i++]=(T)v; }
+            else {
+                uint64_t count=ColumnCodec::getVarint(p,end);
+                if(count==0||count>n-i) throw FileOperationException("Corrupt sales column");
+                fill(values.begin()+i,values.begin()+i+count,(T)v);
+                i+=count;
+            }
+            if(delta) previous=v;
+        }
+    }
+    template<typename T>
+    static void getPacked(const char* p,const char* end,size_t n,vector<T>& values){
+        int64_t low=ColumnCodec::unzigzag(ColumnCodec::getVarint(p,end));
+        if(p>=end) throw FileOperationException("Corrupt sales column");
+        size_t width=(uint8_t)*p++;
+        if((width!=1&&width!=2&&width!=4&&width!=8)||(size_t)(end-p)<n*width) throw FileOperationException("Corrupt sales column");
+        values.resize(n);
+        T* out=values.data();
+        if(width==1) for(size_t i=0;i<n;i++) out[i]=(T)(low+(uint8_t)p[i]);
+        else if(width==2) for(size_t i=0;i<n;i++){ uint16_t v; memcpy(&v,p+2*i,2); out[i]=(T)(low+v); }
+        else if(width==4) for(size_t i=0;i<n;i++){ uint32_t v; memcpy(&v,p+4*i,4); out[i]=(T)(low+v); }
+        else for(size_t i=0;i<n;i++){ uint64_t v; memcpy(&v,p+8*i,8); out[i]=(T)(low+(int64_t)v); }
+    }
+    void getDictionary(const char* p,const char* end,size_t n,vector<int32_t>& values,bool runs){
+        uint64_t count=ColumnCodec::getVarint(p,end);
+        if(count>n) throw FileOperationException("Corrupt sales dictionary");
+        getValues(p,end,(size_t)count,keys,true,false);
+        if(runs) getValues(p,end,n,codes,false,true);
+        else getPacked(p,end,n,codes);
+        values.resize(n);
+        for(size_t i=0;i<n;i++){
+            if(codes[i]>=count) throw FileOperationException("Corrupt sales dictionary");
+            values[i]=keys[codes[i]];
+        }
+    }
+    void decode(int column,const char* p,uint32_t rawSize,uint32_t storedSize,Block& b){
+        const char* end=p+storedSize;
+        if(storedSize<rawSize){
+            ColumnCodec::decompress(p,end,rawSize,scratch);
+            p=scratch.data();
+            end=p+scratch.size();
+        }
+        if(column==0) getValues(p,end,b.rows,b.transactionIds,true,true);
+        else if(column==1) getValues(p,end,b.rows,b.timestamps,true,true);
+        else if(column==2) getDictionary(p,end,b.rows,b.cashierIds,true);
+        else if(column==3) getDictionary(p,end,b.rows,b.productIds,false);
+        else if(column==4) getValues(p,end,b.rows,b.quantities,false,true);
+        else getPacked(p,end,b.rows,b.unitPrices);
+    }
+    template<typename T>
+    static void keepRows(vector<T>& values,const vector<uint32_t>& kept){
+        if(values.empty()) return;
+        for(size_t i=0;i<kept.size();i++) values[i]=values[kept[i]];
+        values.resize(kept.size());
+    }
+public:
+    explicit SalesColumnReader(const string& filename) : file(filename) {
+        if(file.size()<sizeof(SalesColumnWriter::MAGIC)||memcmp(file.begin(),SalesColumnWriter::MAGIC,sizeof(SalesColumnWriter::MAGIC))!=0)
+            throw FileOperationException(filename+" is not a sales export");
+    }
+    size_t fileSize() const { return file.size(); }
+    /* visit(const Block&) once per block with rows stamped from..to; returns the rows visited */
+    template<typename F>
+    size_t scan(unsigned columns,F visit,int64_t from=INT64_MIN,int64_t to=INT64_MAX){
+        bool ranged=from!=INT64_MIN||to!=INT64_MAX;
+        if(ranged) columns|=SALES_TIME;
+        Block b;
+        vector<uint32_t> kept;
+        size_t total=0;
+        const char* p=file.begin()+sizeof(SalesColumnWriter::MAGIC);
+        while(p<file.end()){
+            if((size_t)(file.end()-p)<HEADER) throw FileOperationException("Truncated sales export");
+            uint32_t rows, sizes[2*SalesColumnWriter::COLUMNS];
+            int64_t first, last;
+            memcpy(&rows,p,4); memcpy(&first,p+4,8); memcpy(&last,p+12,8); memcpy(sizes,p+20,sizeof(sizes));
+            const char* column=p+HEADER;
+            size_t payload=0;
+            for(int c=0;c<SalesColumnWriter::COLUMNS;c++){
+                if(sizes[2*c+1]>sizes[2*c]) throw FileOperationException("Corrupt sales export");
+                payload+=sizes[2*c+1];
+            }
+            if((size_t)(file.end()-column)<payload) throw FileOperationException("Truncated sales export");
+            p=column+payload;
+            if(ranged&&(last<from||first>to)) continue;
+            b.rows=rows;
+            for(int c=0;c<SalesColumnWriter::COLUMNS;c++){
+                if(columns&(1u<<c)) decode(c,column,sizes[2*c],sizes[2*c+1],b);
+                column+=sizes[2*c+1];
+            }
+            if(ranged&&(first<from||last>to)){
+                kept.clear();
+                for(uint32_t i=0;i<rows;i++) if(b.timestamps[i]>=from&&b.timestamps[i]<=to) kept.push_back(i);
+                keepRows(b.transactionIds,kept); keepRows(b.timestamps,kept); keepRows(b.cashierIds,kept);
+                keepRows(b.productIds,kept); keepRows(b.quantities,kept); keepRows(b.unitPrices,kept);
+                b.rows=kept.size();
+            }
+            if(b.rows==0) continue;
+            total+=b.rows;
+            visit((const Block&)b);
+        }
+        return total;
+    }
+};
+
+enum WalRecordType : uint8_t { WAL_PRODUCT = 1, WAL_STOCK = 2, WAL_EMPLOYEE = 4, WAL_THRESHOLD = 5,
+                               WAL_SALE = 6, WAL_PROMOTION = 7 };
+
+/* fsyncs a directory so a rename or a file created in it survives a crash */
+inline void syncDirectory(const string& dir){
+    int fd=open(dir.c_str(),O_RDONLY|O_DIRECTORY);
+    if(fd<0) throw FileOperationException("Cannot open "+dir);
+    int rc=fsync(fd);
+    close(fd);
+    if(rc!=0) throw FileOperationException("Cannot sync "+dir);
+}
+
+/* append-only log with group commit: a background thread writes and fdatasyncs whatever has
+   accumulated since the previous flush, so concurrent committers share one fsync. The file starts
+   with a magic and a generation number; a snapshot records the generation it covers, so a log
+   left behind by a crash mid-checkpoint is recognised and skipped instead of applied twice */
+class WriteAheadLog {
+public:
+    static const uint64_t MAGIC = 0x31474f4c584f5453ull; /* "STOXLOG1" */
+    static const size_t HEADER_BYTES = 16;
+private:
+    int fd;
+    bool syncCommits;
+    mutex lock;
+    condition_variable wake, durable;
+    string pending;
+    uint64_t appendedLsn, durableLsn;
+    bool stopping, failed;
+    thread flusher;
+    void flushLoop(){
+        string batch;
+        unique_lock<mutex> guard(lock);
+        while(true){
+            wake.wait(guard,[this]{ return stopping||!pending.empty(); });
+            if(pending.empty()) break;
+            batch.swap(pending);
+            uint64_t target=appendedLsn;
+            guard.unlock();
+            bool ok=true;
+            {
+                STAT_SCOPE(STAT_WAL_SYNC);
+                const char* p=batch.data();
+                size_t left=batch.size();
+                while(left>0){
+                    ssize_t n=::write(fd,p,left);
+                    if(n<0){ if(errno==EINTR) continue; ok=false; break; }
+                    p+=n; left-=(size_t)n;
+                }
+                if(ok&&fdatasync(fd)!=0) ok=false;
+            }
+            STAT_BYTES(STAT_WAL_SYNC,batch.size());
+            batch.clear();
+            guard.lock();
+            if(!ok) failed=true;
+            durableLsn=target;
+            durable.notify_all();
+        }
+    }
+public:
+    WriteAheadLog(const string& path,bool sync)
+        : fd(-1), syncCommits(sync), appendedLsn(0), durableLsn(0), stopping(false), failed(false) {
+        fd=open(path.c_str(),O_WRONLY|O_CREAT|O_APPEND,0644);
+        if(fd<0) throw FileOperationException("Cannot open "+path);
+        flusher=thread(&WriteAheadLog::flushLoop,this);
+    }
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    ~WriteAheadLog(){
+        {
+            lock_guard<mutex> guard(lock);
+            stopping=true;
+        }
+        wake.notify_one();
+        flusher.join();
+        close(fd);
+    }
+    /* frame: u32 payload length, u8 type, payload, u32 checksum over type+payload */
+    void append(WalRecordType type,const string& payload){ waitFor(enqueue(type,payload)); }
+    /* queues a record and returns its log position without waiting for it to reach the disk */
+    uint64_t enqueue(WalRecordType type,const string& payload){
+        STAT_SCOPE(STAT_WAL_APPEND);
+        STAT_BYTES(STAT_WAL_APPEND,9+payload.size());
+        uint32_t length=(uint32_t)payload.size();
+        uint8_t t=type;
+        uint32_t sum=fnv1a(payload.data(),payload.size(),fnv1a((const char*)&t,1));
+        unique_lock<mutex> guard(lock);
+        if(failed) throw FileOperationException("Write-ahead log is not writable");
+        pending.append((const char*)&length,4);
+        pending.push_back((char)t);
+        pending+=payload;
+        pending.append((const char*)&sum,4);
+        appendedLsn+=9+payload.size();
+        wake.notify_one();
+        return appendedLsn;
+    }
+    /* with synchronous commits, blocks until the record at lsn is on disk */
+    void waitFor(uint64_t lsn){
+        if(!syncCommits) return;
+        unique_lock<mutex> guard(lock);
+        durable.wait(guard,[this,lsn]{ return durableLsn>=lsn; });
+        if(failed) throw FileOperationException("Write-ahead log is not writable");
+    }
+    /* blocks until everything appended so far is on disk */
+    void flush(){
+        unique_lock<mutex> guard(lock);
+        uint64_t lsn=appendedLsn;
+        wake.notify_one();
+        durable.wait(guard,[this,lsn]{ return durableLsn>=lsn; });
+        if(failed) throw FileOperationException("Write-ahead log is not writable");
+    }
+    /* empties the log and starts it over as the given generation */
+    void restart(uint64_t generation){
+        flush();
+        lock_guard<mutex> guard(lock);
+        char header[HEADER_BYTES];
+        memcpy(header,&MAGIC,8);
+        memcpy(header+8,&generation,8);
+        if(ftruncate(fd,0)!=0||::write(fd,header,HEADER_BYTES)!=(ssize_t)HEADER_BYTES||fdatasync(fd)!=0)
+            throw FileOperationException("Cannot restart write-ahead log");
+    }
+    /* generation named in a log image's header, 0 for an empty or half-written one */
+    static uint64_t generationOf(const char* begin,const char* end,const string& path){
+        if(!begin||(size_t)(end-begin)<HEADER_BYTES) return 0; /* torn while restarting: nothing was logged yet */
+        uint64_t magic, generation;
+        memcpy(&magic,begin,8);
+        if(magic!=MAGIC) throw FileOperationException("Unknown log format "+path);
+        memcpy(&generation,begin+8,8);
+        return generation;
+    }
+    /* calls visit(type, reader) for every intact record of a log image and returns how many bytes
+       they fill, header included; records stops at the first torn one */
+    template<typename F>
+    static size_t replayImage(const char* begin,const char* end,size_t& records,F visit){
+        const char* p=begin+HEADER_BYTES;
+        while(end-p>=9){
+            uint32_t length;
+            memcpy(&length,p,4);
+            if((size_t)(end-p)<9+(size_t)length) break;
+            uint32_t sum;
+            memcpy(&sum,p+5+length,4);
+            if(fnv1a(p+5,length,fnv1a(p+4,1))!=sum) break;
+            BinaryReader reader(p+5,p+5+length);
+            visit((WalRecordType)(uint8_t)p[4],reader);
+            p+=9+length;
+            records++;
+        }
+        return p-begin;
+    }
+    /* sets generation from the header and, if it is newer than the one the snapshot covers, replays
+       every intact record; a torn tail left by a crash is cut off */
+    template<typename F>
+    static size_t replay(const string& path,uint64_t covered,uint64_t& generation,F visit){
+        generation=0;
+        if(!filesystem::exists(path)) return 0;
+        size_t records=0, good;
+        {
+            MappedFile file(path);
+            generation=generationOf(file.begin(),file.end(),path);
+            if(generation<=covered) return 0;
+            good=replayImage(file.begin(),file.end(),records,visit);
+            if(good==file.size()) return records;
+        }
+        if(::truncate(path.c_str(),(off_t)good)!=0) throw FileOperationException("Cannot repair "+path);
+        return records;
+    }
+};
+
+/* Renders receipts off the checkout path. Checkout only queues the journal record; the writer thread
+   formats whole batches with to_chars into one reused buffer and appends them to a rotating archive
+   <dir>/receipts_NNNNNN.txt, each receipt headed by its transaction ID. Receipts can be rebuilt from
+   the journal, so the archive is written but never fsynced. */
+class ReceiptWriter {
+private:
+    static const size_t ROTATE_BYTES = (size_t)64<<20;
+    static const size_t FLUSH_BYTES = (size_t)1<<20;
+    const TransactionJournal& journal;
+    ProductStore& products;
+    string directory;
+    int fd;
+    int archiveNumber;
+    size_t archiveBytes;
+    mutex lock;
+    condition_variable wake, drained;
+    vector<const TransactionRecord*> pending;
+    uint64_t queued, written;
+    bool stopping, failed;
+    string buffer;
+    thread worker;
+    string archivePath(int number) const {
+        char name[32];
+        snprintf(name,sizeof(name),"receipts_%06d.txt",number);
+        return directory+"/"+name;
+    }
+    void openArchive(){
+        if(fd>=0) close(fd);
+        string path=archivePath(archiveNumber);
+        fd=open(path.c_str(),O_WRONLY|O_CREAT|O_APPEND,0644);
+        if(fd<0) throw FileOperationException("Cannot open "+path);
+        struct stat st;
+        archiveBytes=fstat(fd,&st)==0?(size_t)st.st_size:0;
+    }
+    void put(const char* text,size_t n){ buffer.append(text,n); }
+    void put(const char* text){ buffer.append(text); }
+    void putInt(long long value){
+        char digits[24];
+        auto res=to_chars(digits,digits+sizeof(digits),value);
+        buffer.append(digits,res.ptr-digits);
+    }
+    void putMoney(Cents amount){
+        if(amount<0){ buffer.push_back('-'); amount=-amount; }
+        char digits[24];
+        auto res=to_chars(digits,digits+sizeof(digits)-3,amount/100);
+        char* p=res.ptr;
+        *p++='.';
+        *p++=(char)('0'+amount%100/10);
+        *p++=(char)('0'+amount%10);
+        buffer.append(digits,p-digits);
+    }
+    /* left-justified field of at least width characters, like setw() with left */
+    void padFrom(size_t start,size_t width){
+        size_t used=buffer.size()-start;
+        if(used<width) buffer.append(width-used,' ');
+    }
+    void format(const TransactionRecord& rec){
+        struct tm parts;
+        time_t t=(time_t)rec.timestamp;
+        localtime_r(&t,&parts);
+        char date[32];
+        size_t dateLength=strftime(date,sizeof(date),"%Y-%m-%d %H:%M:%S",&parts);
+        put("========================================\n"
+            "               OBA MARKET\n"
+            "========================================\n"
+            "Transaction ID: ");
+        putInt(rec.id);
+        put("\nDate: "); put(date,dateLength);
+        put("\nCashier ID: "); putInt(rec.cashierId);
+        put("\n----------------------------------------\n"
+            "Item                Qty     Price     Total\n"
+            "----------------------------------------\n");
+        Cents savings=0;
+        for(uint32_t i=0;i<rec.itemCount;i++){
+            const LineItem& item=journal.item(rec,i);
+            Product* p=products.find(item.productId);
+            size_t start=buffer.size();
+            if(p) buffer+=p->getName();
+            else{ buffer.push_back('#'); putInt(item.productId); }
+            padFrom(start,20);
+            start=buffer.size();
+            putInt(item.quantity);
+            padFrom(start,8);
+            buffer.push_back('$');
+            start=buffer.size();
+            putMoney(item.unitPrice);
+            padFrom(start,9);
+            buffer.push_back('$');
+            putMoney(item.unitPrice*item.quantity);
+            buffer.push_back('\n');
+            if(item.discount){
+                put("  Promotion                         -$");
+                putMoney(item.discount);
+                buffer.push_back('\n');
+                savings+=item.discount;
+            }
+        }
+        if(savings){
+            put("----------------------------------------\nYOU SAVED: $");
+            putMoney(savings);
+            buffer.push_back('\n');
+        }
+        put("========================================\nTOTAL: $");
+        putMoney(rec.total);
+        put("\n========================================\n"
+            "      Qarabağ Azərbaycandır!\n"
+            "========================================\n\n");
+    }
+    bool flushBuffer(){
+        STAT_SCOPE(STAT_RECEIPT_WRITE);
+        STAT_BYTES(STAT_RECEIPT_WRITE,buffer.size());
+        const char* p=buffer.data();
+        size_t left=buffer.size();
+        while(left>0){
+            ssize_t n=::write(fd,p,left);
+            if(n<0){ if(errno==EINTR) continue; return false; }
+            p+=n; left-=(size_t)n;
+        }
+        archiveBytes+=buffer.size();
+        buffer.clear();
+        if(archiveBytes>=ROTATE_BYTES){
+            archiveNumber++;
+            try{ openArchive(); } catch(const exception&){ return false; }
+        }
+        return true;
+    }
+    void writeLoop(){
+        vector<const TransactionRecord*> batch;
+        unique_lock<mutex> guard(lock);
+        while(true){
+            wake.wait(guard,[this]{ return stopping||!pending.empty(); });
+            if(pending.empty()) break;
+            batch.swap(pending);
+            guard.unlock();
+            bool ok=true;
+            for(const TransactionRecord* rec:batch){
+                format(*rec);
+                if(buffer.size()>=FLUSH_BYTES&&!(ok=flushBuffer())) break;
+            }
+            if(ok) ok=flushBuffer();
+            buffer.clear();
+            guard.lock();
+            if(!ok) failed=true;
+            written+=batch.size();
+            batch.clear();
+            drained.notify_all();
+        }
+    }
+public:
+    ReceiptWriter(const TransactionJournal& j,ProductStore& p,const string& dir)
+        : journal(j), products(p), directory(dir), fd(-1), archiveNumber(1), archiveBytes(0),
+          queued(0), written(0), stopping(false), failed(false) {
+        filesystem::create_directories(directory);
+        for(auto& entry:filesystem::directory_iterator(directory)){
+            int number;
+            if(sscanf(entry.path().filename().c_str(),"receipts_%d.txt",&number)==1&&number>archiveNumber)
+                archiveNumber=number;
+        }
+        openArchive();
+        if(archiveBytes>=ROTATE_BYTES){ archiveNumber++; openArchive(); }
+        pending.reserve(1024);
+        buffer.reserve(FLUSH_BYTES+4096);
+        worker=thread(&ReceiptWriter::writeLoop,this);
+    }
+    ReceiptWriter(const ReceiptWriter&) = delete;
+    ReceiptWriter& operator=(const ReceiptWriter&) = delete;
+    ~ReceiptWriter(){
+        {
+            lock_guard<mutex> guard(lock);
+            stopping=true;
+        }
+        wake.notify_one();
+        worker.join();
+        close(fd);
+    }
+    /* no formatting or I/O here; journal records never move, so the pointer stays valid */
+    void enqueue(const TransactionRecord& rec){
+        lock_guard<mutex> guard(lock);
+        pending.push_back(&rec);
+        queued++;
+        wake.notify_one();
+    }
+    /* blocks until every queued receipt is in the archive */
+    void flush(){
+        unique_lock<mutex> guard(lock);
+        uint64_t target=queued;
+        wake.notify_one();
+        drained.wait(guard,[this,target]{ return written>=target; });
+        if(failed) throw FileOperationException("Receipt archive is not writable");
+    }
+    const string& getDirectory() const { return directory; }
+};
+
+/* what a list view shows: one page of rows after filtering and sorting. page counts from 0 and
+   pageSize 0 means every row */
+struct ViewOptions {
+    string sortBy;          /* products: id stock price name category; employees: id name salary;
+                               transactions: id date total items */
+    bool descending;
+    string category;        /* products only, empty for all */
+    int cashierId;          /* transactions only, 0 for all */
+    int64_t from, to;       /* transactions only, epoch seconds, inclusive */
+    size_t page, pageSize;
+    bool color;
+    bool plain;             /* tab-separated rows without banner or footer, for other tools */
+    ViewOptions() : sortBy("id"), descending(false), cashierId(0), from(INT64_MIN), to(INT64_MAX),
+                    page(0), pageSize(25), color(getenv("NO_COLOR")==nullptr), plain(false) {}
+    size_t wanted() const { return pageSize?(page+1)*pageSize:SIZE_MAX; }
+};
+
+/* keeps the k first items under less() out of a single scan, so showing page p of a sorted list
+   costs O(n log((p+1)*size)) instead of sorting everything */
+template<typename T,typename Less>
+class TopK {
+private:
+    vector<T> heap;
+    size_t limit, seen;
+    Less less;
+public:
+    TopK(size_t k,Less l) : limit(k), seen(0), less(l) {}
+    void offer(const T& item){
+        seen++;
+        if(heap.size()<limit){
+            heap.push_back(item);
+            push_heap(heap.begin(),heap.end(),less);
+        } else if(limit&&less(item,heap.front())){
+            pop_heap(heap.begin(),heap.end(),less);
+            heap.back()=item;
+            push_heap(heap.begin(),heap.end(),less);
+        }
+    }
+    size_t matched() const { return seen; }
+    /* sorted rows from position skip on */
+    vector<T> finish(size_t skip){
+        sort_heap(heap.begin(),heap.end(),less);
+        if(skip>=heap.size()) return vector<T>();
+        heap.erase(heap.begin(),heap.begin()+skip);
+        return move(heap);
+    }
+};
+template<typename T,typename Less>
+TopK<T,Less> makeTopK(size_t k,Less less){ return TopK<T,Less>(k,less); }
+
+/* rows are rendered into one string per page. Without color the escape codes are dropped; in
+   tab-separated mode cells are written whole and split by tabs */
+class PageWriter {
+private:
+    string text;
+    bool color, tabs;
+public:
+    PageWriter(bool useColor,bool tabSeparated=false) : color(useColor&&!tabSeparated), tabs(tabSeparated) { text.reserve(1<<16); }
+    PageWriter& style(const char* code){ if(color) text+=code; return *this; }
+    PageWriter& put(string_view s){ text+=s; return *this; }
+    PageWriter& put(char c){ text+=c; return *this; }
+    /* pads or cuts to width terminal columns, counting UTF-8 sequences as one column */
+    PageWriter& cell(string_view s,size_t width,bool alignRight=false){
+        if(tabs){
+            text+=s;
+            text+='\t';
+            return *this;
+        }
+        size_t columns=0, end=0;
+        while(end<s.size()&&columns<width){
+            end++;
+            while(end<s.size()&&((unsigned char)s[end]&0xC0)==0x80) end++;
+            columns++;
+        }
+        if(alignRight) text.append(width-columns,' ');
+        text.append(s.data(),end);
+        if(!alignRight) text.append(width-columns,' ');
+        text+=' ';
+        return *this;
+    }
+    PageWriter& cell(long long value,size_t width){ return cell(to_string(value),width,true); }
+    PageWriter& endRow(){
+        while(!text.empty()&&(text.back()==' '||text.back()=='\t')) text.pop_back();
+        text+='\n';
+        return *this;
+    }
+    size_t size() const { return text.size(); }
+    /* one write per page instead of a flush per row */
+    void flush(){
+        cout.write(text.data(),(streamsize)text.size());
+        cout.flush();
+        text.clear();
+    }
+};
+
+class SupermarketManager : public SaleListener {
+private:
+    ProductStore products;
+    EmployeeRegistry employees;
+    int nextProductId;
+    int nextEmployeeId;
+    int idStride, idResidue; /* in a chain, ids this store mints are congruent to its residue */
+    TransactionJournal transactions;
+    SalesAnalytics analytics;
+    LowStockIndex lowStock;
+    PricingEngine pricing;
+    ProductSearchIndex searchIndex;
+    unique_ptr<WriteAheadLog> wal;
+    unique_ptr<ReceiptWriter> receipts;
+    string snapshotPath, walPath, storageDir;
+    uint64_t logGeneration;
+    static void writeProduct(BinaryWriter& w,const Product& p){
+        w.put<int32_t>(p.getId());
+        w.putString(p.getName());
+        w.put<double>(p.getPrice());
+        w.put<int32_t>(p.getStock());
+        w.putString(p.getCategory());
+    }
+    Product& readProduct(BinaryReader& r){
+        int id=r.get<int32_t>();
+        string name=r.getString();
+        double price=r.get<double>();
+        int stock=r.get<int32_t>();
+        string category=r.getString();
+        Product& p=storeProduct(Product(id,name,price,stock,category));
+        nextProductId=max(nextProductId,id+1);
+        return p;
+    }
+    static void writeEmployee(BinaryWriter& w,const Employee* e){
+        const Manager* m=dynamic_cast<const Manager*>(e);
+        const Cashier* c=dynamic_cast<const Cashier*>(e);
+        w.put<uint8_t>(m?1:2);
+        w.put<int32_t>(e->getId());
+        w.putString(e->getName());
+        w.putString(e->getPhone());
+        w.put<double>(e->getSalary());
+        w.put<double>(m?m->getBonus():0);
+        w.put<int32_t>(c?c->getTransactionCount():0);
+    }
+    void readEmployee(BinaryReader& r){
+        uint8_t kind=r.get<uint8_t>();
+        int id=r.get<int32_t>();
+        string name=r.getString(), phone=r.getString();
+        double salary=r.get<double>(), bonus=r.get<double>();
+        int count=r.get<int32_t>();
+        if(kind==1) employees.add(new Manager(name,id,phone,salary,bonus));
+        else{
+            employees.add(new Cashier(name,id,phone,salary));
+            analytics.registerCashier(id);
+            employees.setTransactionCount(id,count);
+        }
+        nextEmployeeId=max(nextEmployeeId,id+1);
+    }
+    void writeTransaction(BinaryWriter& w,const TransactionRecord& rec) const {
+        w.put<int32_t>(rec.id);
+        w.put<int32_t>(rec.cashierId);
+        w.put<int64_t>(rec.timestamp);
+        w.put<uint32_t>(rec.shard);
+        w.put<uint32_t>(rec.itemCount);
+        for(uint32_t i=0;i<rec.itemCount;i++){
+            const LineItem& item=transactions.item(rec,i);
+            w.put<int32_t>(item.productId);
+            w.put<int32_t>(item.quantity);
+            w.put<int64_t>(item.unitPrice);
+            w.put<int64_t>(item.discount);
+        }
+    }
+    /* replayed transactions re-apply their stock deductions, snapshot ones do not */
+    const TransactionRecord& readTransaction(BinaryReader& r,bool applyStock){
+        int id=r.get<int32_t>(), cashier=r.get<int32_t>();
+        int64_t when=r.get<int64_t>();
+        uint32_t shard=r.get<uint32_t>();
+        uint32_t n=r.get<uint32_t>();
+        vector<LineItem> lines(n);
+        Cents total=0;
+        for(auto& line:lines){
+            line.productId=r.get<int32_t>();
+            line.quantity=r.get<int32_t>();
+            line.unitPrice=r.get<int64_t>();
+            line.discount=r.get<int64_t>();
+            total+=line.unitPrice*line.quantity-line.discount;
+            Product* p=products.find(line.productId);
+            if(p&&applyStock){
+                int after=p->applyStockDelta(-line.quantity);
+                lowStock.stockChanged(*p,after+line.quantity,after);
+            }
+            analytics.recordItem(line.productId,line.quantity,line.unitPrice);
+            if(line.discount) analytics.recordDiscount(line.productId,line.discount);
+        }
+        analytics.recordTransaction(cashier,when,total);
+        return transactions.append((int)shard,cashier,lines,total,id,when);
+    }
+    /* returns the log generation the snapshot covers */
+    uint64_t loadSnapshot(const MappedFile& file){
+        uint32_t sum=0;
+        if(file.size()>=12) memcpy(&sum,file.end()-4,4);
+        if(file.size()<12||fnv1a(file.begin(),file.size()-4)!=sum)
+            throw FileOperationException("Corrupt snapshot "+snapshotPath);
+        BinaryReader r(file.begin(),file.end()-4);
+        if(r.get<uint64_t>()!=SNAPSHOT_MAGIC) throw FileOperationException("Unknown snapshot format "+snapshotPath);
+        uint64_t covered=r.get<uint64_t>();
+        nextProductId=max(nextProductId,r.get<int32_t>());
+        nextEmployeeId=max(nextEmployeeId,r.get<int32_t>());
+        transactions.reserveId(r.get<int32_t>()-1);
+        uint64_t count=r.get<uint64_t>();
+        products.reserve(products.size()+count);
+        for(uint64_t i=0;i<count;i++) readProduct(r);
+        count=r.get<uint64_t>();
+        for(uint64_t i=0;i<count;i++) readEmployee(r);
+        count=r.get<uint64_t>();
+        for(uint64_t i=0;i<count;i++) readTransaction(r,false);
+        count=r.get<uint64_t>();
+        for(uint64_t i=0;i<count;i++) readThreshold(r);
+        count=r.get<uint64_t>();
+        for(uint64_t i=0;i<count;i++) pricing.addRule(readRule(r));
+        return covered;
+    }
+    void replayRecord(WalRecordType type,BinaryReader& r){
+        switch(type){
+            case WAL_PRODUCT: readProduct(r); break;
+            case WAL_STOCK:{
+                int id=r.get<int32_t>(), delta=r.get<int32_t>();
+                Product* p=products.find(id);
+                if(p){
+                    int after=p->applyStockDelta(delta);
+                    lowStock.stockChanged(*p,after-delta,after);
+                }
+                break;
+            }
+            case WAL_SALE:{
+                const TransactionRecord& rec=readTransaction(r,true);
+                employees.recordSale(rec.cashierId);
+                break;
+            }
+            case WAL_PROMOTION:
+                if(r.get<uint8_t>()==1) pricing.addRule(readRule(r));
+                else pricing.removeRule(r.get<int32_t>());
+                break;
+            case WAL_EMPLOYEE: readEmployee(r); break;
+            case WAL_THRESHOLD: readThreshold(r); break;
+        }
+    }
+    Product& storeProduct(Product p){
+        Product* existing=products.find(p.getId());
+        bool reindex=!existing||existing->nameView()!=p.nameView()||existing->getCategoryId()!=p.getCategoryId();
+        if(existing&&reindex) searchIndex.remove(*existing);
+        Product& stored=products.insert(move(p));
+        if(reindex) searchIndex.add(stored);
+        analytics.registerProduct(stored.getId(),stored.getCategory());
+        lowStock.registerProduct(stored);
+        pricing.registerProduct(stored.getId(),stored.getCategory());
+        return stored;
+    }
+    static void writeRule(BinaryWriter& w,const PricingEngine::Rule& rule){
+        w.put<int32_t>(rule.id);
+        w.put<uint8_t>(rule.kind);
+        w.put<int32_t>(rule.productId);
+        w.put<int32_t>(rule.buy);
+        w.put<int32_t>(rule.get);
+        w.putString(rule.category);
+        w.put<int32_t>(rule.basisPoints);
+        w.put<uint32_t>((uint32_t)rule.products.size());
+        for(int id:rule.products) w.put<int32_t>(id);
+        w.put<int64_t>(rule.bundlePrice);
+    }
+    static PricingEngine::Rule readRule(BinaryReader& r){
+        PricingEngine::Rule rule;
+        rule.id=r.get<int32_t>();
+        rule.kind=(PricingEngine::RuleKind)r.get<uint8_t>();
+        rule.productId=r.get<int32_t>();
+        rule.buy=r.get<int32_t>();
+        rule.get=r.get<int32_t>();
+        rule.category=r.getString();
+        rule.basisPoints=r.get<int32_t>();
+        rule.products.resize(r.get<uint32_t>());
+        for(auto& id:rule.products) id=r.get<int32_t>();
+        rule.bundlePrice=r.get<int64_t>();
+        return rule;
+    }
+    static void writeThreshold(BinaryWriter& w,const LowStockIndex::Override& o){
+        w.put<int32_t>(o.productId);
+        w.putString(o.category);
+        w.put<int32_t>(o.threshold);
+    }
+    void readThreshold(BinaryReader& r){
+        int id=r.get<int32_t>();
+        string category=r.getString();
+        int value=r.get<int32_t>();
+        if(id<0) lowStock.setCategoryThreshold(category,value,products);
+        else if(Product* p=products.find(id)) lowStock.setProductThreshold(*p,value);
+    }
+    template<typename F>
+    void logRecord(WalRecordType type,F fill){
+        if(!wal) return;
+        BinaryWriter w;
+        fill(w);
+        wal->append(type,w.buffer);
+    }
+public:
+    static const uint64_t SNAPSHOT_MAGIC = 0x35504e53584f5453ull; /* "STOXSNP5" */
+    static const int REORDER_COVER_DAYS = 14;
+    struct ReorderLine {
+        Product* product;
+        int stock, threshold;
+        double dailySales, daysOfCover;
+        int orderQuantity;
+    };
+    SupermarketManager()
+        : nextProductId(1001), nextEmployeeId(1), idStride(1), idResidue(0), logGeneration(0) {}
+    ~SupermarketManager(){
+        receipts.reset();
+        wal.reset();
+    }
+    /* loads <dir>/stox.snap, replays <dir>/stox.wal on top and keeps logging every change there.
+       With syncCommits each commit waits for its group fsync; otherwise the flusher catches up behind.
+       Returns false when the directory held no previous state. */
+    bool attachStorage(const string& dir,bool syncCommits=true){
+        filesystem::create_directories(dir);
+        storageDir=dir;
+        snapshotPath=dir+"/stox.snap";
+        walPath=dir+"/stox.wal";
+        auto start=chrono::steady_clock::now();
+        bool hasSnapshot=filesystem::exists(snapshotPath);
+        uint64_t covered=hasSnapshot?loadSnapshot(MappedFile(snapshotPath)):0;
+        size_t replayed=WriteAheadLog::replay(walPath,covered,logGeneration,[this](WalRecordType type,BinaryReader& r){
+            replayRecord(type,r);
+        });
+        wal.reset(new WriteAheadLog(walPath,syncCommits));
+        if(logGeneration<=covered){ /* new, empty or already folded into the snapshot */
+            logGeneration=covered+1;
+            wal->restart(logGeneration);
+            syncDirectory(dir);
+        }
+        if(!hasSnapshot&&replayed==0) return false;
+        double elapsed=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        cout << BRIGHT_GREEN << "✓ Recovered " << products.size() << " products, " << employees.size()
+             << " employees and replayed " << replayed << " log records in " << RESET
+             << fixed << setprecision(3) << elapsed << "s" << endl;
+        return true;
+    }
+    /* reads <dir>'s snapshot and log without creating, repairing or logging anything, so it is safe
+       beside a server that owns the directory: the log is copied rather than mapped since the server
+       may truncate it, a record still being written is just left out, and a checkpoint landing
+       between the two reads is retried. Returns false when the directory held no state. */
+    bool loadStorage(const string& dir){
+        if(!filesystem::is_directory(dir)) throw FileOperationException("No data directory "+dir);
+        snapshotPath=dir+"/stox.snap";
+        walPath=dir+"/stox.wal";
+        for(int attempt=1;;attempt++){
+            unique_ptr<MappedFile> snapshot;
+            if(filesystem::exists(snapshotPath)) snapshot.reset(new MappedFile(snapshotPath));
+            string log;
+            if(filesystem::exists(walPath)){
+                ifstream in(walPath,ios::binary);
+                if(!in) throw FileOperationException("Cannot open "+walPath);
+                log.assign(istreambuf_iterator<char>(in),istreambuf_iterator<char>());
+            }
+            uint64_t covered=0;
+            if(snapshot&&snapshot->size()>=16) memcpy(&covered,snapshot->begin()+8,8);
+            uint64_t generation=WriteAheadLog::generationOf(log.data(),log.data()+log.size(),walPath);
+            if(generation>covered+1){ /* the snapshot was replaced after we mapped ours */
+                if(attempt<5) continue;
+                throw FileOperationException("Storage in "+dir+" kept changing while being read");
+            }
+            if(snapshot) loadSnapshot(*snapshot);
+            size_t records=0;
+            if(generation>covered)
+                WriteAheadLog::replayImage(log.data(),log.data()+log.size(),records,[this](WalRecordType type,BinaryReader& r){
+                    replayRecord(type,r);
+                });
+            return snapshot||records>0;
+        }
+    }
+    /* every committed sale from here on gets a receipt in <dir>'s rotating archive */
+    void attachReceipts(const string& dir){
+        receipts.reset(new ReceiptWriter(transactions,products,dir));
+    }
+    /* writes a fresh snapshot covering the current log generation, then starts the next one; a crash
+       in between leaves a log the snapshot already covers, which recovery skips. Run it while no
+       lane is checking out */
+    void checkpoint(){
+        if(!wal) return;
+        STAT_SCOPE(STAT_CHECKPOINT);
+        wal->flush();
+        BinaryWriter w;
+        w.buffer.reserve(products.size()*48+1024);
+        w.put<uint64_t>(SNAPSHOT_MAGIC);
+        w.put<uint64_t>(logGeneration);
+        w.put<int32_t>(nextProductId);
+        w.put<int32_t>(nextEmployeeId);
+        w.put<int32_t>(transactions.peekNextId());
+        w.put<uint64_t>(products.size());
+        products.forEach([&w](Product& p){ writeProduct(w,p); });
+        w.put<uint64_t>(employees.size());
+        for(auto e:employees.all()) writeEmployee(w,e);
+        w.put<uint64_t>(transactions.size());
+        transactions.forEach([this,&w](const TransactionRecord& rec){ writeTransaction(w,rec); });
+        vector<LowStockIndex::Override> thresholds=lowStock.overrides();
+        w.put<uint64_t>(thresholds.size());
+        for(auto& o:thresholds) writeThreshold(w,o);
+        w.put<uint64_t>(pricing.getRules().size());
+        for(auto& rule:pricing.getRules()) writeRule(w,rule);
+        w.put<uint32_t>(fnv1a(w.buffer.data(),w.buffer.size()));
+        STAT_BYTES(STAT_CHECKPOINT,w.buffer.size());
+        string tmp=snapshotPath+".tmp";
+        int fd=open(tmp.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+        if(fd<0) throw FileOperationException("Cannot open "+tmp);
+        const char* p=w.buffer.data();
+        size_t left=w.buffer.size();
+        while(left>0){
+            ssize_t n=::write(fd,p,left);
+            if(n<0&&errno==EINTR) continue;
+            if(n<0){ close(fd); throw FileOperationException("Cannot write "+tmp); }
+            p+=n; left-=(size_t)n;
+        }
+        if(fsync(fd)!=0){ close(fd); throw FileOperationException("Cannot sync "+tmp); }
+        close(fd);
+        if(rename(tmp.c_str(),snapshotPath.c_str())!=0) throw FileOperationException("Cannot replace "+snapshotPath);
+        syncDirectory(storageDir);
+        wal->restart(++logGeneration);
+        cout << BRIGHT_GREEN << "✓ Checkpoint written to " << RESET << CYAN << snapshotPath << RESET << endl;
+    }
+    void flushStorage(){
+        if(receipts) receipts->flush();
+        if(wal) wal->flush();
+    }
+    /* waits for one group fsync covering every change logged so far */
+    void syncLog(){ if(wal) wal->flush(); }
+    int peekNextProductId() const { return nextProductId; }
+    /* next id at or above next that belongs to this store */
+    int mintId(int& next){
+        int id=next+((idResidue-next%idStride)%idStride+idStride)%idStride;
+        next=id+1;
+        return id;
+    }
+    /* makes this store one of storeCount in a chain: new products and employees take ids congruent
+       to storeIndex, which keeps the id-indexed tables dense, and transaction ids start at
+       firstTransactionId */
+    void joinChain(int storeIndex,int storeCount,int firstTransactionId){
+        idStride=max(1,storeCount);
+        idResidue=storeIndex%idStride;
+        transactions.reserveId(firstTransactionId-1);
+    }
+    template<typename F>
+    void forEachProduct(F visit){ products.forEach(visit); }
+    /* sum of sale totals stamped from..to inclusive */
+    Cents revenueBetween(int64_t from,int64_t to) const {
+        Cents sum=0;
+        transactions.forEachInTimeRange(from,to,[&sum](const TransactionRecord& rec){ sum+=rec.total; });
+        return sum;
+    }
+    size_t transactionCount() const { return transactions.size(); }
+    size_t productCount() const { return products.size(); }
+    Product& addProductQuiet(string name,double price,int stock,string category){
+        Product& p=storeProduct(Product(mintId(nextProductId),name,price,stock,category));
+        logRecord(WAL_PRODUCT,[&p](BinaryWriter& w){ writeProduct(w,p); });
+        return p;
+    }
+    void addProduct(string name,double price,int stock,string category){
+        Product& p=addProductQuiet(name,price,stock,category);
+        cout << BRIGHT_GREEN << "✓ Product added successfully! ID: " << p.getId() << RESET << endl;
+    }
+    static int compareKeys(long long a,long long b){ return (a>b)-(a<b); }
+    /* rows of o's page in order, plus how many products passed the filter */
+    vector<Product*> selectProducts(const ViewOptions& o,const StockSnapshot& snapshot,size_t& matched){
+        const string keys[]={"id","stock","price","name","category"};
+        int key=(int)(find(begin(keys),end(keys),o.sortBy)-begin(keys));
+        if(key==5) throw invalid_argument("Unknown sort key '"+o.sortBy+"' (id, stock, price, name, category)");
+        bool desc=o.descending;
+        auto top=makeTopK<Product*>(o.wanted(),[key,desc,&snapshot](Product* a,Product* b){
+            int c=0;
+            if(key==1) c=compareKeys(snapshot.stock(*a),snapshot.stock(*b));
+            else if(key==2) c=compareKeys(a->getPriceCents(),b->getPriceCents());
+            else if(key==3) c=a->nameView().compare(b->nameView());
+            else if(key==4) c=a->getCategory().compare(b->getCategory());
+            if(c==0) c=compareKeys(a->getId(),b->getId());
+            return desc?c>0:c<0;
+        });
+        int category=o.category.empty()?-1:ProductText::shared().findCategory(o.category);
+        if(o.category.empty()) products.forEach([&top](Product& p){ top.offer(&p); });
+        else if(category>=0) products.forEach([&top,category](Product& p){ if(p.getCategoryId()==category) top.offer(&p); });
+        matched=top.matched();
+        return top.finish(o.page*o.pageSize);
+    }
+    size_t renderProducts(const ViewOptions& o,PageWriter& w){
+        size_t matched;
+        StockSnapshot snapshot;
+        vector<Product*> rows=selectProducts(o,snapshot,matched);
+        w.style(BOLD).cell("ID",8,true).cell("Name",28).cell("Category",16).cell("Price",10,true).cell("Stock",10,true)
+         .cell("Barcode",12).style(RESET).endRow();
+        for(Product* p:rows){
+            int stock=snapshot.stock(*p);
+            w.style(BRIGHT_CYAN).cell(p->getId(),8).style(RESET).style(BOLD).cell(p->nameView(),28).style(RESET)
+             .style(MAGENTA).cell(p->getCategory(),16).style(RESET)
+             .style(GREEN).cell(formatCents(p->getPriceCents()),10,true).style(RESET)
+             .style(stock<20?RED:(stock<50?YELLOW:GREEN)).cell(stock,10).style(RESET)
+             .style(YELLOW).cell(p->getBarcode(),12).style(RESET).endRow();
+            if(w.size()>=(1<<20)) w.flush(); /* only reached when printing every row */
+        }
+        return matched;
+    }
+    vector<Employee*> selectEmployees(const ViewOptions& o,size_t& matched){
+        const string keys[]={"id","name","salary"};
+        int key=(int)(find(begin(keys),end(keys),o.sortBy)-begin(keys));
+        if(key==3) throw invalid_argument("Unknown sort key '"+o.sortBy+"' (id, name, salary)");
+        bool desc=o.descending;
+        auto top=makeTopK<Employee*>(o.wanted(),[key,desc](Employee* a,Employee* b){
+            int c=0;
+            if(key==1) c=a->getName().compare(b->getName());
+            else if(key==2){ double x=a->calculateSalary(), y=b->calculateSalary(); c=(x>y)-(x<y); }
+            if(c==0) c=compareKeys(a->getId(),b->getId());
+            return desc?c>0:c<0;
+        });
+        for(Employee* e:employees.all()) top.offer(e);
+        matched=top.matched();
+        return top.finish(o.page*o.pageSize);
+    }
+    size_t renderEmployees(const ViewOptions& o,PageWriter& w){
+        size_t matched;
+        vector<Employee*> rows=selectEmployees(o,matched);
+        w.style(BOLD).cell("ID",6,true).cell("Name",24).cell("Position",10).cell("Phone",16).cell("Salary",12,true)
+         .cell("Total",12,true).style(RESET).endRow();
+        for(Employee* e:rows){
+            w.style(CYAN).cell(e->getId(),6).style(RESET).cell(e->getName(),24).cell(e->getPosition(),10)
+             .cell(e->getPhone(),16).style(GREEN).cell(formatCents(toCents(e->getSalary())),12,true).style(RESET)
+             .style(BRIGHT_GREEN).cell(formatCents(toCents(e->calculateSalary())),12,true).style(RESET).endRow();
+        }
+        return matched;
+    }
+    vector<const TransactionRecord*> selectTransactions(const ViewOptions& o,size_t& matched){
+        const string keys[]={"id","date","total","items"};
+        int key=(int)(find(begin(keys),end(keys),o.sortBy)-begin(keys));
+        if(key==4) throw invalid_argument("Unknown sort key '"+o.sortBy+"' (id, date, total, items)");
+        bool desc=o.descending;
+        auto top=makeTopK<const TransactionRecord*>(o.wanted(),[key,desc](const TransactionRecord* a,const TransactionRecord* b){
+            int c=0;
+            if(key==1) c=compareKeys(a->timestamp,b->timestamp);
+            else if(key==2) c=compareKeys(a->total,b->total);
+            else if(key==3) c=compareKeys(a->itemCount,b->itemCount);
+            if(c==0) c=compareKeys(a->id,b->id);
+            return desc?c>0:c<0;
+        });
+        auto offer=[&top,&o](const TransactionRecord& rec){
+            if(o.cashierId&&rec.cashierId!=o.cashierId) return;
+            if(rec.timestamp<o.from||rec.timestamp>o.to) return;
+            top.offer(&rec);
+        };
+        if(o.from!=INT64_MIN||o.to!=INT64_MAX) transactions.forEachInTimeRange(o.from,o.to,offer);
+        else if(o.cashierId) transactions.forEachByCashier(o.cashierId,offer);
+        else transactions.forEach(offer);
+        matched=top.matched();
+        return top.finish(o.page*o.pageSize);
+    }
+    size_t renderTransactions(const ViewOptions& o,PageWriter& w){
+        size_t matched;
+        vector<const TransactionRecord*> rows=selectTransactions(o,matched);
+        w.style(BOLD).cell("ID",10,true).cell("Date",19).cell("Cashier",8,true).cell("Lines",6,true).cell("Total",12,true)
+         .style(RESET).endRow();
+        for(const TransactionRecord* rec:rows){
+            w.style(BRIGHT_YELLOW).cell(rec->id,10).style(RESET).cell(formatTimestamp(rec->timestamp),19)
+             .cell(rec->cashierId,8).cell(rec->itemCount,6).style(BRIGHT_GREEN).cell(formatCents(rec->total),12,true)
+             .style(RESET).endRow();
+            if(w.size()>=(1<<20)) w.flush();
+        }
+        return matched;
+    }
+    /* renders one page; render(o,w) writes the column header and rows and returns the match count */
+    template<typename Render>
+    size_t showPage(const ViewOptions& o,const char* title,const char* background,Render render){
+        PageWriter w(o.color,o.plain);
+        if(!o.plain) w.put('\n').style(BOLD).style(background).style(WHITE).put("           ").put(title)
+                      .put("           ").style(RESET).put('\n');
+        size_t matched=render(o,w);
+        if(!o.plain){
+            size_t pages=o.pageSize?max<size_t>(1,(matched+o.pageSize-1)/o.pageSize):1;
+            w.style(CYAN).put("Page ").put(to_string(min(o.page+1,pages))).put(" of ").put(to_string(pages))
+             .put(" | ").put(to_string(matched)).put(" row(s) | sorted by ").put(o.sortBy)
+             .put(o.descending?" desc":"").style(RESET).put('\n');
+        }
+        w.flush();
+        return matched;
+    }
+    /* pages through a view until q: n/p move, g <page> jumps, s <key> sorts, r reverses,
+       c <category> filters products (c * clears) */
+    template<typename Render>
+    void browse(ViewOptions o,const char* title,const char* background,Render render){
+        while(true){
+            size_t matched;
+            try{
+                matched=showPage(o,title,background,render);
+            } catch(const invalid_argument& e){
+                cout << RED << "✗ " << e.what() << RESET << "\n";
+                o.sortBy="id";
+                continue;
+            }
+            size_t pages=o.pageSize?max<size_t>(1,(matched+o.pageSize-1)/o.pageSize):1;
+            cout << YELLOW << "n/p page, g <page>, s <key>, r reverse, c <category|*>, q quit: " << RESET;
+            string command;
+            if(!(cin>>command)||command=="q") return;
+            if(command=="n"&&o.page+1<pages) o.page++;
+            else if(command=="p"&&o.page>0) o.page--;
+            else if(command=="r") o.descending=!o.descending;
+            else if(command=="s"){ cin>>o.sortBy; o.page=0; }
+            else if(command=="c"){ cin>>o.category; if(o.category=="*") o.category.clear(); o.page=0; }
+            else if(command=="g"){
+                size_t page;
+                if(cin>>page&&page>0) o.page=min(page,pages)-1;
+                else{ cin.clear(); cin.ignore(numeric_limits<streamsize>::max(),'\n'); }
+            }
+        }
+    }
+    void displayProducts(ViewOptions o=ViewOptions()){
+        if(products.empty()){ 
+            cout << YELLOW << "⚠ No products in inventory." << RESET << "\n"; 
+            return; 
+        }
+        browse(o,"PRODUCT INVENTORY",BG_BLUE,[this](const ViewOptions& v,PageWriter& w){ return renderProducts(v,w); });
+    }
+    /* returns the new stock level */
+    int updateProductStockQuiet(int id,int quantity){
+        Product* p=products.find(id);
+        if(!p) throw ProductNotFoundException();
+        int after=p->updateStock(quantity);
+        lowStock.stockChanged(*p,after-quantity,after);
+        logRecord(WAL_STOCK,[id,quantity](BinaryWriter& w){ w.put<int32_t>(id); w.put<int32_t>(quantity); });
+        return after;
+    }
+    void updateProductStock(int id,int quantity){
+        updateProductStockQuiet(id,quantity);
+        cout << BRIGHT_GREEN << "✓ Stock updated successfully!" << RESET << "\n";
+    }
+    void generateProductBarcode(int id){
+        Product* p=products.find(id);
+        if(!p) throw ProductNotFoundException();
+        string filename = p->getBarcode()+".pbm";
+        p->generateBarcode(filename);
+        cout << BRIGHT_GREEN << "✓ Barcode generated: " << RESET << CYAN << filename << RESET << endl;
+    }
+    /* renders every label into dir, splitting the catalog across all cores */
+    void generateAllBarcodes(const string& dir){
+        filesystem::create_directories(dir);
+        vector<Product*> all;
+        all.reserve(products.size());
+        products.forEach([&all](Product& p){ all.push_back(&p); });
+        int workers=(int)max(1u,thread::hardware_concurrency());
+        atomic<size_t> failed(0);
+        auto start=chrono::steady_clock::now();
+        vector<thread> pool;
+        for(int w=0;w<workers;w++){
+            pool.emplace_back([&all,&dir,&failed,w,workers](){
+                for(size_t i=w;i<all.size();i+=workers){
+                    try{
+                        all[i]->generateBarcode(dir+"/"+all[i]->getBarcode()+".pbm");
+                    } catch(const exception&){
+                        failed++;
+                    }
+                }
+            });
+        }
+        for(auto& t:pool) t.join();
+        double elapsed=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        cout << BRIGHT_GREEN << "✓ Generated " << all.size()-failed.load() << " barcodes in " << RESET
+             << CYAN << dir << RESET << " (" << fixed << setprecision(2) << elapsed << "s, "
+             << workers << " threads)" << endl;
+        if(failed.load()) cout << RED << "✗ " << failed.load() << " labels could not be written" << RESET << endl;
+    }
+    /* reads every .pbm label in dir back, in parallel, and checks that it decodes to PRD<id> of a
+       catalog product and that the file is named after that barcode */
+    void verifyLabels(const string& dir,int workers=0){
+        vector<string> files;
+        for(auto& entry:filesystem::directory_iterator(dir))
+            if(entry.is_regular_file()&&entry.path().extension()==".pbm") files.push_back(entry.path().string());
+        if(workers<=0) workers=(int)max(1u,thread::hardware_concurrency());
+        atomic<size_t> next(0), matched(0), unreadable(0), unknown(0), misnamed(0), bytes(0);
+        mutex problemLock;
+        vector<string> problems;
+        auto report=[&problemLock,&problems](const string& file,const string& why){
+            lock_guard<mutex> guard(problemLock);
+            if(problems.size()<10) problems.push_back(file+": "+why);
+        };
+        auto start=chrono::steady_clock::now();
+        vector<thread> pool;
+        for(int w=0;w<workers;w++){
+            pool.emplace_back([&](){
+                vector<char> image;
+                vector<uint32_t> runs;
+                vector<uint8_t> row;
+                const size_t BATCH=64;
+                for(size_t first;(first=next.fetch_add(BATCH))<files.size();){
+                    for(size_t i=first;i<min(first+BATCH,files.size());i++){
+                        const string& file=files[i];
+                        int fd=open(file.c_str(),O_RDONLY);
+                        struct stat info;
+                        if(fd<0||fstat(fd,&info)!=0){
+                            if(fd>=0) close(fd);
+                            unreadable++;
+                            report(file,"cannot open");
+                            continue;
+                        }
+                        image.resize((size_t)info.st_size);
+                        ssize_t got=info.st_size?pread(fd,image.data(),image.size(),0):0;
+                        close(fd);
+                        if(got!=(ssize_t)image.size()){ unreadable++; report(file,"short read"); continue; }
+                        bytes+=image.size();
+                        string payload;
+                        try{
+                            payload=Code39::decodePbm(image.data(),image.size(),runs,row);
+                        } catch(const exception&){
+                            unreadable++;
+                            report(file,"no Code39 symbol");
+                            continue;
+                        }
+                        int id=Product::idFromBarcode(payload);
+                        if(id<0||!products.find(id)){ unknown++; report(file,"decodes to "+payload+", not in the catalog"); continue; }
+                        if(filesystem::path(file).stem().string()!=payload){ misnamed++; report(file,"decodes to "+payload); continue; }
+                        matched++;
+                    }
+                }
+            });
+        }
+        for(auto& t:pool) t.join();
+        double elapsed=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        size_t bad=unreadable.load()+unknown.load()+misnamed.load();
+        cout << "\n" << BOLD << BG_BLUE << WHITE << "           LABEL VERIFICATION           " << RESET << "\n";
+        cout << CYAN << "Labels: " << RESET << files.size() << CYAN << " in " << RESET << dir << CYAN << " ("
+             << RESET << fixed << setprecision(2) << elapsed << "s, " << setprecision(0)
+             << (elapsed>0?files.size()/elapsed:0) << " labels/s, " << setprecision(1)
+             << (elapsed>0?bytes.load()/1048576.0/elapsed:0) << " MB/s, " << workers << " threads" << CYAN << ")" << RESET << "\n";
+        cout << GREEN << "  ✓ match catalog:   " << matched.load() << RESET << "\n";
+        cout << (bad?RED:GREEN) << "  ✗ unreadable:      " << unreadable.load() << "\n"
+             << "  ✗ unknown product: " << unknown.load() << "\n"
+             << "  ✗ wrong file name: " << misnamed.load() << RESET << "\n";
+        for(auto& problem:problems) cout << RED << "    " << problem << RESET << "\n";
+        /* file names are unique, so matching labels are distinct products */
+        if(matched.load()<products.size())
+            cout << YELLOW << "⚠ " << products.size()-matched.load() << " catalog product(s) have no matching label here" << RESET << "\n";
+    }
+    void addManager(string name,string phone,double salary,double bonus){
+        Manager* m = new Manager(name,mintId(nextEmployeeId),phone,salary,bonus);
+        employees.add(m);
+        logRecord(WAL_EMPLOYEE,[m](BinaryWriter& w){ writeEmployee(w,m); });
+        cout << BRIGHT_GREEN << "✓ Manager added successfully! ID: " << m->getId() << RESET << endl;
+    }
+    Cashier& addCashierQuiet(string name,string phone,double salary){
+        Cashier* c = new Cashier(name,mintId(nextEmployeeId),phone,salary);
+        employees.add(c);
+        analytics.registerCashier(c->getId());
+        logRecord(WAL_EMPLOYEE,[c](BinaryWriter& w){ writeEmployee(w,c); });
+        return *c;
+    }
+    void addCashier(string name,string phone,double salary){
+        Cashier& c=addCashierQuiet(name,phone,salary);
+        cout << BRIGHT_GREEN << "✓ Cashier added successfully! ID: " << c.getId() << RESET << endl;
+    }
+    void displayEmployees(ViewOptions o=ViewOptions()){
+        if(employees.empty()){ 
+            cout << YELLOW << "⚠ No employees registered." << RESET << "\n"; 
+            return; 
+        }
+        browse(o,"EMPLOYEE LIST",BG_GREEN,[this](const ViewOptions& v,PageWriter& w){ return renderEmployees(v,w); });
+    }
+    void onItemSold(const Product& product,int quantity,Cents unitPrice,int stockLeft){
+        analytics.recordItem(product.getId(),quantity,unitPrice);
+        lowStock.stockChanged(product,stockLeft+quantity,stockLeft);
+    }
+    void setReorderThreshold(int productId,int value){
+        Product* p=products.find(productId);
+        if(!p) throw ProductNotFoundException();
+        lowStock.setProductThreshold(*p,value);
+        LowStockIndex::Override o{productId,"",value};
+        logRecord(WAL_THRESHOLD,[&o](BinaryWriter& w){ writeThreshold(w,o); });
+        cout << BRIGHT_GREEN << "✓ Reorder threshold for " << RESET << p->getName() << BRIGHT_GREEN
+             << " set to " << RESET << value << "\n";
+    }
+    void setCategoryReorderThreshold(const string& category,int value){
+        lowStock.setCategoryThreshold(category,value,products);
+        LowStockIndex::Override o{-1,category,value};
+        logRecord(WAL_THRESHOLD,[&o](BinaryWriter& w){ writeThreshold(w,o); });
+        cout << BRIGHT_GREEN << "✓ Reorder threshold for category " << RESET << category << BRIGHT_GREEN
+             << " set to " << RESET << value << "\n";
+    }
+    /* only visits products already below threshold; sales velocity is averaged since the first sale,
+       and the order brings stock up to REORDER_COVER_DAYS of sales or twice the threshold */
+    vector<ReorderLine> reorderSuggestions(){
+        vector<int> low=lowStock.lowProducts();
+        int64_t first=analytics.firstSaleTime();
+        double days=first<0?1:max(1.0,(time(0)-first)/86400.0);
+        vector<ReorderLine> lines;
+        lines.reserve(low.size());
+        StockSnapshot snapshot;
+        for(int id:low){
+            Product* p=products.find(id);
+            if(!p) continue;
+            ReorderLine line;
+            line.product=p;
+            line.threshold=lowStock.thresholdOf(id);
+            line.dailySales=analytics.product(id).units/days;
+            int stock=line.stock=snapshot.stock(*p);
+            line.daysOfCover=line.dailySales>0?stock/line.dailySales:numeric_limits<double>::infinity();
+            int target=max(2*line.threshold,(int)ceil(line.dailySales*REORDER_COVER_DAYS));
+            line.orderQuantity=max(1,target-stock);
+            lines.push_back(line);
+        }
+        sort(lines.begin(),lines.end(),[](const ReorderLine& a,const ReorderLine& b){
+            return a.daysOfCover<b.daysOfCover||(a.daysOfCover==b.daysOfCover&&a.product->getId()<b.product->getId());
+        });
+        return lines;
+    }
+    void showLowStock(){
+        auto start=chrono::steady_clock::now();
+        vector<ReorderLine> lines=reorderSuggestions();
+        double elapsed=chrono::duration<double,micro>(chrono::steady_clock::now()-start).count();
+        cout << "\n" << BOLD << BG_RED << WHITE << "           LOW STOCK           " << RESET << "\n";
+        if(lines.empty()) cout << BRIGHT_GREEN << "✓ Every product is above its reorder threshold." << RESET << "\n";
+        for(auto& line:lines){
+            cout << CYAN << "ID: " << RESET << line.product->getId()
+                 << CYAN << " | " << RESET << left << setw(20) << line.product->getName() << right
+                 << CYAN << " | Stock: " << RESET << RED << line.stock << RESET << "/" << line.threshold
+                 << CYAN << " | Cover: " << RESET << fixed << setprecision(1);
+            if(isinf(line.daysOfCover)) cout << "no sales";
+            else cout << line.daysOfCover << " days";
+            cout << CYAN << " | Order: " << RESET << BRIGHT_YELLOW << line.orderQuantity << RESET << "\n";
+        }
+        cout << CYAN << lines.size() << " of " << products.size() << " products listed in " << RESET
+             << fixed << setprecision(2) << elapsed << " us\n";
+    }
+    void exportReorderList(const string& filename){
+        vector<ReorderLine> lines=reorderSuggestions();
+        ofstream out(filename);
+        if(!out) throw FileOperationException("Cannot open "+filename);
+        out<<"ProductID,Name,Category,Stock,Threshold,DailySales,DaysOfCover,OrderQuantity\n";
+        for(auto& line:lines){
+            Product* p=line.product;
+            out<<p->getId()<<","<<csvField(p->getName())<<","<<csvField(p->getCategory())<<","
+               <<line.stock<<","<<line.threshold<<","<<fixed<<setprecision(2)<<line.dailySales<<",";
+            if(!isinf(line.daysOfCover)) out<<line.daysOfCover;
+            out<<","<<line.orderQuantity<<"\n";
         }
+        out.close();
+        cout << BRIGHT_GREEN << "✓ " << lines.size() << " reorder line(s) saved to " << RESET << CYAN << filename << RESET << endl;
     }
-    void addProduct(string name,double price,int stock,string category){
-        Product* p=new Product(nextProductId++,name,price,stock,category);
-        products[p->getId()] = p;
-        cout << BRIGHT_GREEN << "✓ Product added successfully! ID: " << p->getId() << RESET << endl;
-    }
-    void displayProducts(){
-        if(products.empty()){ 
-            cout << YELLOW << "⚠ No products in inventory." << RESET << "\n"; 
-            return; 
+    void showSalesReport(){
+        auto start=chrono::steady_clock::now();
+        SalesAnalytics::Totals all=analytics.overall();
+        vector<SalesAnalytics::Ranked> top=analytics.topSellers(10);
+        vector<SalesAnalytics::Ranked> categories=analytics.byCategory();
+        double elapsed=chrono::duration<double,micro>(chrono::steady_clock::now()-start).count();
+        cout << "\n" << BOLD << BG_BLUE << WHITE << "           SALES ANALYTICS           " << RESET << "\n";
+        cout << CYAN << "Transactions: " << RESET << all.transactions << CYAN << ", Units: " << RESET << all.units
+             << CYAN << ", Revenue: " << RESET << BRIGHT_GREEN << "$" << fixed << setprecision(2)
+             << all.revenueCents/100.0 << RESET << "\n";
+        cout << "\n" << BRIGHT_MAGENTA << "Top sellers" << RESET << "\n";
+        for(size_t i=0;i<top.size();i++){
+            Product* p=products.find(top[i].id);
+            cout << "  " << setw(2) << i+1 << ". " << left << setw(22) << (p?p->getName():to_string(top[i].id)) << right
+                 << setw(8) << top[i].units << " units  $" << top[i].revenueCents/100.0 << "\n";
+        }
+        cout << "\n" << BRIGHT_MAGENTA << "By category" << RESET << "\n";
+        for(auto& c:categories)
+            cout << "  " << left << setw(22) << analytics.categoryName(c.id) << right << setw(8) << c.units
+                 << " units  $" << c.revenueCents/100.0 << "\n";
+        cout << "\n" << BRIGHT_MAGENTA << "By cashier" << RESET << "\n";
+        for(auto e:employees.all()){
+            if(!employees.findCashier(e->getId())) continue;
+            SalesAnalytics::Totals t=analytics.cashier(e->getId());
+            cout << "  " << left << setw(22) << e->getName() << right << setw(8) << t.transactions
+                 << " sales  $" << t.revenueCents/100.0 << "\n";
+        }
+        cout << "\n" << BRIGHT_MAGENTA << "By hour" << RESET << "\n";
+        for(int h=0;h<24;h++){
+            SalesAnalytics::Totals t=analytics.hour(h);
+            if(t.transactions==0) continue;
+            cout << "  " << setfill('0') << setw(2) << h << ":00" << setfill(' ') << setw(20) << t.transactions
+                 << " sales  $" << t.revenueCents/100.0 << "\n";
         }
-        cout << "\n" << BOLD << BG_BLUE << WHITE << "           PRODUCT INVENTORY           " << RESET << "\n";
-        cout << BRIGHT_BLUE << "═══════════════════════════════════════════════════════════════════════════════" << RESET << "\n";
-        for(auto& p:products) p.second->display();
-        cout << BRIGHT_BLUE << "═══════════════════════════════════════════════════════════════════════════════" << RESET << "\n";
+        cout << CYAN << "\nReport assembled in " << RESET << elapsed << " us\n";
     }
-    void updateProductStock(int id,int quantity){
-        if(products.find(id)==products.end()) throw ProductNotFoundException();
-        products[id]->updateStock(quantity);
-        cout << BRIGHT_GREEN << "✓ Stock updated successfully!" << RESET << "\n";
+    SalesAnalytics& getAnalytics(){ return analytics; }
+    void runPayroll(){
+        auto start=chrono::steady_clock::now();
+        EmployeeRegistry::PayrollSummary pay=employees.runPayroll();
+        double elapsed=chrono::duration<double,micro>(chrono::steady_clock::now()-start).count();
+        cout << "\n" << BOLD << BG_GREEN << WHITE << "           PAYROLL RUN           " << RESET << "\n";
+        cout << CYAN << "Employees: " << RESET << pay.headcount << "\n" << fixed << setprecision(2)
+             << CYAN << "Base salaries: " << RESET << GREEN << "$" << pay.baseTotal << RESET << "\n"
+             << CYAN << "Bonuses: " << RESET << YELLOW << "$" << pay.bonusTotal << RESET << "\n"
+             << CYAN << "Transaction commission: " << RESET << YELLOW << "$" << pay.commissionTotal << RESET << "\n"
+             << CYAN << "Total payroll: " << RESET << BRIGHT_GREEN << "$" << pay.grandTotal << RESET << "\n"
+             << CYAN << "Computed in " << RESET << elapsed << " us\n";
     }
-    void generateProductBarcode(int id){
-        if(products.find(id)==products.end()) throw ProductNotFoundException();
-        string filename = products[id]->getBarcode()+".pbm";
-        products[id]->generateBarcode(filename);
-        cout << BRIGHT_GREEN << "✓ Barcode generated: " << RESET << CYAN << filename << RESET << endl;
+    void addPromotion(PricingEngine::Rule rule){
+        vector<int> required=rule.products;
+        if(rule.kind==PricingEngine::MULTI_BUY) required.push_back(rule.productId);
+        for(int id:required) if(!products.find(id)) throw ProductNotFoundException();
+        rule.id=pricing.addRule(rule);
+        logRecord(WAL_PROMOTION,[&rule](BinaryWriter& w){ w.put<uint8_t>(1); writeRule(w,rule); });
+        cout << BRIGHT_GREEN << "✓ Promotion #" << rule.id << " active: " << RESET << PricingEngine::describe(rule) << "\n";
     }
-    void addManager(string name,string phone,double salary,double bonus){
-        Manager* m = new Manager(name,nextEmployeeId++,phone,salary,bonus);
-        employees.push_back(m);
-        cout << BRIGHT_GREEN << "✓ Manager added successfully! ID: " << m->getId() << RESET << endl;
+    void removePromotion(int id){
+        if(!pricing.removeRule(id)) throw invalid_argument("No promotion with that ID!");
+        logRecord(WAL_PROMOTION,[id](BinaryWriter& w){ w.put<uint8_t>(2); w.put<int32_t>(id); });
+        cout << BRIGHT_GREEN << "✓ Promotion #" << id << " removed" << RESET << "\n";
     }
-    void addCashier(string name,string phone,double salary){
-        Cashier* c = new Cashier(name,nextEmployeeId++,phone,salary);
-        employees.push_back(c);
-        cout << BRIGHT_GREEN << "✓ Cashier added successfully! ID: " << c->getId() << RESET << endl;
+    void displayPromotions() const {
+        cout << "\n" << BOLD << BG_GREEN << WHITE << "           PROMOTIONS           " << RESET << "\n";
+        if(pricing.getRules().empty()) cout << YELLOW << "⚠ No active promotions." << RESET << "\n";
+        for(auto& rule:pricing.getRules())
+            cout << CYAN << "#" << rule.id << RESET << "  " << PricingEngine::describe(rule) << "\n";
     }
-    void displayEmployees(){
-        if(employees.empty()){ 
-            cout << YELLOW << "⚠ No employees registered." << RESET << "\n"; 
-            return; 
-        }
-        cout << "\n" << BOLD << BG_GREEN << WHITE << "           EMPLOYEE LIST           " << RESET << "\n";
-        cout << BRIGHT_MAGENTA << "══════════════════════════════════════════════════════════" << RESET << "\n";
-        for(auto e:employees){ 
-            e->display(); 
-            cout << BRIGHT_MAGENTA << "──────────────────────────────────────────────────────────" << RESET << "\n"; 
+    PricingEngine& getPricing(){ return pricing; }
+    Product* findProduct(int id){ return products.find(id); }
+    Product* findProductByBarcode(const string& barcode){ return products.findByBarcode(barcode); }
+    /* best matches for free text typed at the till or in the search menu */
+    vector<Product*> searchProducts(const string& query,size_t limit=10){
+        vector<Product*> found;
+        for(auto& m:searchIndex.search(query,limit))
+            if(Product* p=products.find(m.productId)) found.push_back(p);
+        return found;
+    }
+    void showSearch(const string& query){
+        auto start=chrono::steady_clock::now();
+        vector<Product*> found=searchProducts(query,20);
+        double elapsed=chrono::duration<double,micro>(chrono::steady_clock::now()-start).count();
+        cout << "\n" << BOLD << BG_BLUE << WHITE << "           PRODUCT SEARCH           " << RESET << "\n";
+        if(found.empty()) cout << YELLOW << "⚠ Nothing matches \"" << query << "\"." << RESET << "\n";
+        for(Product* p:found) p->display();
+        cout << CYAN << found.size() << " match(es) in " << RESET << fixed << setprecision(1) << elapsed << " us\n";
+    }
+    /* lets the cashier pick one of the top matches for a typed name, nullptr when skipped */
+    Product* pickFromSearch(const string& query){
+        vector<Product*> found=searchProducts(query,5);
+        if(found.empty()) return nullptr;
+        for(size_t i=0;i<found.size();i++)
+            cout << "  " << CYAN << i+1 << ")" << RESET << " " << found[i]->getName()
+                 << CYAN << " | " << RESET << GREEN << "$" << formatCents(found[i]->getPriceCents()) << RESET
+                 << CYAN << " | Stock: " << RESET << found[i]->getStock() << "\n";
+        cout << YELLOW << "Pick 1-" << found.size() << " (0 to skip): " << RESET;
+        size_t choice=0;
+        if(!(cin>>choice)){ cin.clear(); cin.ignore(numeric_limits<streamsize>::max(),'\n'); return nullptr; }
+        return choice>=1&&choice<=found.size()?found[choice-1]:nullptr;
+    }
+    ProductSearchIndex& getSearchIndex(){ return searchIndex; }
+    /* employees are only added from the menu, never while lanes are checking out; a transaction
+       with no items is refused before it takes an id, a log record or a receipt */
+    const TransactionRecord& commitTransaction(Transaction& trans,int lane=0){
+        STAT_SCOPE(STAT_COMMIT);
+        if(trans.getItems().empty()) throw EmptyTransactionException();
+        trans.applyPromotions(pricing);
+        if(trans.getDiscount())
+            for(auto& line:trans.getItems())
+                if(line.discount) analytics.recordDiscount(line.productId,line.discount);
+        uint64_t lsn=0;
+        const TransactionRecord& rec=transactions.append(lane,trans.getCashierId(),trans.getItems(),trans.getTotal(),0,0,
+            [this,&lsn](const TransactionRecord& r){ /* logged in id order within the shard, as replay expects */
+                if(!wal) return;
+                BinaryWriter w;
+                writeTransaction(w,r);
+                lsn=wal->enqueue(WAL_SALE,w.buffer);
+            });
+        analytics.recordTransaction(rec.cashierId,rec.timestamp,rec.total);
+        if(lsn) wal->waitFor(lsn);
+        employees.recordSale(rec.cashierId);
+        if(receipts) receipts->enqueue(rec);
+        return rec;
+    }
+    /* thread-safe checkout of a whole basket; items that fail (unknown id, no stock) are skipped,
+       and a basket where all of them fail throws EmptyTransactionException */
+    const TransactionRecord& checkout(int cashierId,const vector<pair<int,int>>& basket,int lane=0){
+        STAT_SCOPE(STAT_CHECKOUT);
+        if(!employees.findCashier(cashierId)) throw invalid_argument("No cashier with that ID!");
+        thread_local Transaction trans;
+        trans.reset(cashierId,this);
+        {
+            StockVersions::Scope basketEpoch; /* a snapshot sees the whole basket or none of it */
+            for(auto& item:basket){
+                try{
+                    trans.addItem(products.find(item.first),item.second);
+                } catch(const exception&){
+                }
+            }
         }
+        return commitTransaction(trans,lane);
+    }
+    void displayTransaction(const TransactionRecord& rec) const {
+        cout << BRIGHT_YELLOW << "Transaction ID: " << RESET << rec.id 
+             << BRIGHT_YELLOW << " | Date: " << RESET << formatTimestamp(rec.timestamp)
+             << BRIGHT_YELLOW << " | Cashier: " << RESET << rec.cashierId 
+             << BRIGHT_YELLOW << " | Total: " << RESET << BRIGHT_GREEN << "$" << formatCents(rec.total) << RESET << "\n";
     }
     void processTransaction(int cashierId){
-        Transaction* trans = new Transaction(nextTransactionId++,cashierId);
+        if(!employees.findCashier(cashierId)) throw invalid_argument("No cashier with that ID!");
+        Transaction trans(cashierId,this);
         cout << "\n" << BOLD << BRIGHT_CYAN << "━━━━━━━ NEW TRANSACTION ━━━━━━━" << RESET << "\n";
         while(true){
-            cout << YELLOW << "Enter Product ID (0 to finish): " << RESET;
-            int pid; cin>>pid;
-            if(pid==0) break;
-            if(products.find(pid)==products.end()){
+            cout << YELLOW << "Enter Product ID, barcode or name (0 to finish): " << RESET;
+            string code; cin>>code;
+            if(code=="0") break;
+            bool numeric=isdigit((unsigned char)code[0]);
+            Product* product=numeric ? products.find(atoi(code.c_str())) : products.findByBarcode(code);
+            if(!product&&!numeric) product=pickFromSearch(code);
+            if(!product){
                 cout << RED << "✗ Product not found!" << RESET << "\n"; 
                 continue;
             }
             cout << YELLOW << "Enter quantity: " << RESET;
             int qty; cin>>qty;
             try{
-                trans->addItem(products[pid],qty);
-                cout << BRIGHT_GREEN << "✓ Item added: " << RESET << products[pid]->getName() 
+                trans.addItem(product,qty);
+                cout << BRIGHT_GREEN << "✓ Item added: " << RESET << product->getName() 
                      << CYAN << " x " << qty << RESET << endl;
             } catch(const exception& e){
                 cout << RED << "✗ Error: " << e.what() << RESET << endl;
             }
         }
-        trans->display();
-        transactions.push(trans);
-        for(auto e:employees){
-            if(e->getId()==cashierId){
-                Cashier* c=dynamic_cast<Cashier*>(e);
-                if(c) c->incrementTransactions();
-                break;
-            }
-        }
-        stringstream ss;
-        ss<<"receipt_"<<trans->getTotal()<<".txt";
-        trans->generateReceipt(ss.str());
-        cout << BRIGHT_GREEN << "✓ Receipt saved to: " << RESET << CYAN << ss.str() << RESET << endl;
+        const TransactionRecord& rec=commitTransaction(trans);
+        displayTransaction(rec);
+        if(trans.getDiscount())
+            cout << BRIGHT_MAGENTA << "★ Promotions saved: " << RESET << GREEN << "$" << formatCents(trans.getDiscount()) << RESET << "\n";
+        if(receipts)
+            cout << BRIGHT_GREEN << "✓ Receipt #" << rec.id << " queued for: " << RESET << CYAN
+                 << receipts->getDirectory() << RESET << endl;
     }
-    void displayTransactions(){
+    void displayTransactions(ViewOptions o=ViewOptions()){
         if(transactions.empty()){ 
             cout << YELLOW << "⚠ No transactions recorded." << RESET << "\n"; 
             return; 
         }
-        cout << "\n" << BOLD << BG_BLUE << WHITE << "           TRANSACTIONS           " << RESET << "\n";
-        cout << BRIGHT_YELLOW << "═════════════════════════════════════════════════════════════════════════" << RESET << "\n";
-        queue<Transaction*> temp = transactions;
-        while(!temp.empty()){
-            temp.front()->display();
-            temp.pop();
-        }
-        cout << BRIGHT_YELLOW << "═════════════════════════════════════════════════════════════════════════" << RESET << "\n";
+        browse(o,"TRANSACTIONS",BG_BLUE,[this](const ViewOptions& v,PageWriter& w){ return renderTransactions(v,w); });
+    }
+    /* one page of a view without prompting; what is products, employees or transactions */
+    size_t printView(const string& what,const ViewOptions& o){
+        if(what=="products")
+            return showPage(o,"PRODUCT INVENTORY",BG_BLUE,[this](const ViewOptions& v,PageWriter& w){ return renderProducts(v,w); });
+        if(what=="employees")
+            return showPage(o,"EMPLOYEE LIST",BG_GREEN,[this](const ViewOptions& v,PageWriter& w){ return renderEmployees(v,w); });
+        if(what=="transactions")
+            return showPage(o,"TRANSACTIONS",BG_BLUE,[this](const ViewOptions& v,PageWriter& w){ return renderTransactions(v,w); });
+        throw invalid_argument("Unknown view '"+what+"' (products, employees, transactions)");
+    }
+    /* mode 1: id range, 2: cashier, 3: time range (from/to are epoch seconds) */
+    void searchTransactions(int mode,int64_t from,int64_t to){
+        size_t found=0;
+        auto show=[this,&found](const TransactionRecord& rec){ displayTransaction(rec); found++; };
+        cout << "\n" << BOLD << BG_BLUE << WHITE << "           TRANSACTION SEARCH           " << RESET << "\n";
+        if(mode==1) transactions.forEachInIdRange((int)from,(int)to,show);
+        else if(mode==2) transactions.forEachByCashier((int)from,show);
+        else transactions.forEachInTimeRange(from,to,show);
+        cout << CYAN << found << " transaction(s) found" << RESET << "\n";
     }
     void saveProductsToFile(const string& filename){
+        STAT_SCOPE(STAT_SAVE_PRODUCTS);
         ofstream out(filename);
         if(!out) throw FileOperationException("Cannot open "+filename);
         out<<"ProductID,Name,Price,Stock,Category\n";
-        for(auto& p:products) p.second->saveToFile(out);
+        StockSnapshot snapshot;
+        products.forEach([&out,&snapshot](Product& p){ p.saveToFile(out,snapshot.stock(p)); });
+        STAT_BYTES(STAT_SAVE_PRODUCTS,out.tellp());
         out.close();
         cout << BRIGHT_GREEN << "✓ Products saved to " << RESET << CYAN << filename << RESET << endl;
     }
     void saveEmployeesToFile(const string& filename){
+        STAT_SCOPE(STAT_SAVE_EMPLOYEES);
         ofstream out(filename);
         if(!out) throw FileOperationException("Cannot open "+filename);
         out<<"EmployeeID,Name,Phone,Position,BaseSalary,TotalSalary\n";
-        for(auto e:employees){
-            out<<e->getId()<<","<<e->getName()<<","
-               <<"PHONE"<<","<<e->getPosition()<<","
+        for(auto e:employees.all()){
+            out<<e->getId()<<","<<csvField(e->getName())<<","
+               <<csvField(e->getPhone())<<","<<e->getPosition()<<","
                <<fixed<<setprecision(2)<<e->getSalary()<<","
                <<e->calculateSalary()<<"\n";
         }
+        STAT_BYTES(STAT_SAVE_EMPLOYEES,out.tellp());
         out.close();
         cout << BRIGHT_GREEN << "✓ Employees saved to " << RESET << YELLOW << filename << RESET << endl;
     }
-    void loadProductsFromFile(const string& filename){
-        ifstream in(filename);
-        if(!in) throw FileOperationException("Cannot open "+filename);
-        string line;
-        getline(in,line);
-        while(getline(in,line)){
-            stringstream ss(line);
-            string id,name,price,stock,category;
-            getline(ss,id,',');
-            getline(ss,name,',');
-            getline(ss,price,',');
-            getline(ss,stock,',');
-            getline(ss,category,',');
-            Product* p=new Product(stoi(id),name,stod(price),stoi(stock),category);
-            products[p->getId()] = p;
-            nextProductId = max(nextProductId,p->getId()+1);
+    /* every line sold from..to, in transaction order: a .csv file gets one row per line, any other
+       name the columnar format. Returns the number of lines */
+    static size_t writeSales(const TransactionJournal& journal,const string& filename,int64_t from,int64_t to){
+        size_t lines=0;
+        if(filesystem::path(filename).extension()==".csv"){
+            ofstream out(filename);
+            if(!out) throw FileOperationException("Cannot open "+filename);
+            out<<"TransactionID,Timestamp,CashierID,ProductID,Quantity,UnitPrice\n";
+            string row;
+            journal.forEachInTimeRange(from,to,[&](const TransactionRecord& rec){
+                string head=to_string(rec.id)+","+formatTimestamp(rec.timestamp)+","+to_string(rec.cashierId)+",";
+                for(uint32_t i=0;i<rec.itemCount;i++){
+                    const LineItem& line=journal.item(rec,i);
+                    row=head;
+                    row+=to_string(line.productId); row+=',';
+                    row+=to_string(line.quantity); row+=',';
+                    row+=formatCents(line.unitPrice); row+='\n';
+                    out.write(row.data(),row.size());
+                }
+                lines+=rec.itemCount;
+            });
+            out.close();
+            if(!out) throw FileOperationException("Cannot write "+filename);
+            return lines;
+        }
+        SalesColumnWriter writer(filename);
+        journal.forEachInTimeRange(from,to,[&](const TransactionRecord& rec){
+            for(uint32_t i=0;i<rec.itemCount;i++) writer.add(rec,journal.item(rec,i));
+            lines+=rec.itemCount;
+        });
+        writer.close();
+        return lines;
+    }
+    void exportSales(const string& filename,int64_t from=INT64_MIN,int64_t to=INT64_MAX){
+        size_t lines=writeSales(transactions,filename,from,to);
+        cout << BRIGHT_GREEN << "✓ " << lines << " sale line(s) exported to " << RESET << CYAN << filename << RESET
+             << " (" << fixed << setprecision(1) << filesystem::file_size(filename)/1024.0 << " KB)" << endl;
+    }
+    void loadProductsFromFile(const string& filename,bool report=true,int parseWorkers=0){
+        auto start=chrono::steady_clock::now();
+        ProductCsvParser parser;
+        {
+            STAT_SCOPE(STAT_LOAD_PRODUCTS);
+            parser.parse(filename,parseWorkers);
+            STAT_BYTES(STAT_LOAD_PRODUCTS,filesystem::file_size(filename));
+            products.reserve(products.size()+parser.rowCount);
+            parser.drain([this](Product&& p){
+                int id=p.getId();
+                storeProduct(move(p));
+                nextProductId = max(nextProductId,id+1);
+            });
+        }
+        double seconds=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        if(report) cout << BRIGHT_GREEN << "✓ Products loaded from " << RESET << CYAN << filename << RESET
+             << " (" << parser.rowCount << " rows, " << fixed << setprecision(0)
+             << (seconds>0?parser.rowCount/seconds:0) << " rows/s, parse "
+             << setprecision(3) << parser.seconds << "s of " << seconds << "s)" << endl;
+        checkpoint();
+    }
+};
+
+class BatchReplayer {
+private:
+    struct LaneStats {
+        size_t baskets, itemsAccepted, itemsRejected;
+        vector<double> latencies;
+        LaneStats() : baskets(0), itemsAccepted(0), itemsRejected(0) {}
+    };
+    SupermarketManager& manager;
+    static bool parseInt(const char*& p,const char* end,int& value){
+        bool neg=false;
+        if(p<end&&*p=='-'){ neg=true; p++; }
+        if(p>=end||*p<'0'||*p>'9') return false;
+        long v=0;
+        while(p<end&&*p>='0'&&*p<='9') v=v*10+(*p++-'0');
+        value=(int)(neg?-v:v);
+        return true;
+    }
+    static double percentile(const vector<double>& sorted,double q){
+        if(sorted.empty()) return 0;
+        return sorted[(size_t)(q*(sorted.size()-1))];
+    }
+    void replayRange(const char* p,const char* end,int lane,LaneStats& stats){
+        vector<pair<int,int>> basket;
+        while(p<end){
+            const char* eol=(const char*)memchr(p,'\n',end-p);
+            if(!eol) eol=end;
+            while(p<eol&&(*p==' '||*p=='\t'||*p=='\r')) p++;
+            int cashierId;
+            if(p<eol&&*p!='#'&&parseInt(p,eol,cashierId)){
+                basket.clear();
+                while(p<eol){
+                    while(p<eol&&(*p==' '||*p=='\t'||*p=='\r'||*p==',')) p++;
+                    int pid,qty=1;
+                    if(!parseInt(p,eol,pid)) break;
+                    if(p<eol&&*p==':'){ p++; if(!parseInt(p,eol,qty)) break; }
+                    basket.push_back(make_pair(pid,qty));
+                }
+                auto t0=chrono::steady_clock::now();
+                uint32_t accepted=0;
+                try{
+                    accepted=manager.checkout(cashierId,basket,lane).itemCount;
+                } catch(const exception&){ /* unknown cashier or nothing sellable: the whole basket is rejected */
+                }
+                auto t1=chrono::steady_clock::now();
+                stats.latencies.push_back(chrono::duration<double,micro>(t1-t0).count());
+                stats.itemsAccepted+=accepted;
+                stats.itemsRejected+=basket.size()-accepted;
+                stats.baskets++;
+            }
+            p=eol+1;
         }
+    }
+public:
+    BatchReplayer(SupermarketManager& m) : manager(m) {}
+    /* log format: one basket per line, "<cashierId> <productId>:<qty> <productId>:<qty> ..."
+       a bare product id counts as quantity 1, lines starting with '#' are ignored.
+       With several lanes the log is cut into contiguous line ranges replayed concurrently. */
+    double replayFile(const string& filename,int lanes=1){
+        ifstream in(filename,ios::binary);
+        if(!in) throw FileOperationException("Cannot open "+filename);
+        string data((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
         in.close();
-        cout << BRIGHT_GREEN << "✓ Products loaded from " << RESET << CYAN << filename << RESET << endl;
+        if(lanes<1) lanes=1;
+        vector<const char*> cuts(1,data.data());
+        const char* end=data.data()+data.size();
+        for(int i=1;i<lanes;i++){
+            const char* c=data.data()+data.size()*i/lanes;
+            if(c<cuts.back()) c=cuts.back();
+            const char* eol=(const char*)memchr(c,'\n',end-c);
+            cuts.push_back(eol?eol+1:end);
+        }
+        cuts.push_back(end);
+        vector<LaneStats> stats(lanes);
+        auto start=chrono::steady_clock::now();
+        if(lanes==1) replayRange(cuts[0],cuts[1],0,stats[0]);
+        else{
+            vector<thread> workers;
+            for(int i=0;i<lanes;i++)
+                workers.emplace_back(&BatchReplayer::replayRange,this,cuts[i],cuts[i+1],i,ref(stats[i]));
+            for(auto& w:workers) w.join();
+        }
+        double elapsed=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        LaneStats total;
+        for(auto& lane:stats){
+            total.baskets+=lane.baskets;
+            total.itemsAccepted+=lane.itemsAccepted;
+            total.itemsRejected+=lane.itemsRejected;
+            total.latencies.insert(total.latencies.end(),lane.latencies.begin(),lane.latencies.end());
+        }
+        vector<double>& latencies=total.latencies;
+        sort(latencies.begin(),latencies.end());
+        size_t items=total.itemsAccepted+total.itemsRejected;
+        cout << "\n" << BOLD << BG_BLUE << WHITE << "           BATCH REPLAY REPORT           " << RESET << "\n";
+        cout << CYAN << "Lanes: " << RESET << lanes
+             << CYAN << ", Baskets: " << RESET << total.baskets
+             << CYAN << ", Items: " << RESET << items
+             << CYAN << " (" << RESET << GREEN << total.itemsAccepted << RESET << CYAN << " accepted, "
+             << RESET << RED << total.itemsRejected << RESET << CYAN << " rejected)" << RESET << "\n";
+        cout << CYAN << "Elapsed: " << RESET << fixed << setprecision(3) << elapsed << "s\n";
+        cout << CYAN << "Throughput: " << RESET << BRIGHT_GREEN << fixed << setprecision(0)
+             << (elapsed>0?total.baskets/elapsed:0) << RESET << " baskets/s, "
+             << BRIGHT_GREEN << (elapsed>0?items/elapsed:0) << RESET << " items/s\n";
+        cout << CYAN << "Basket latency (us): " << RESET << fixed << setprecision(2)
+             << "p50=" << percentile(latencies,0.50) << " p90=" << percentile(latencies,0.90)
+             << " p99=" << percentile(latencies,0.99) << " p99.9=" << percentile(latencies,0.999)
+             << " max=" << (latencies.empty()?0:latencies.back()) << "\n";
+        return elapsed>0?total.baskets/elapsed:0;
+    }
+};
+
+atomic<bool> serverStopRequested(false);
+void requestServerStop(int){ serverStopRequested.store(true); }
+
+/* Headless point-of-sale server on a Unix domain socket. The protocol is one request per line and
+   one response line per request, in order, so terminals may pipeline freely:
+       PING                          OK PONG
+       INFO                          OK <products> <nextProductId> <transactions>
+       FIND <id>  / SCAN <barcode>   OK <id> <price> <stock> <barcode> <name>
+       SEARCH <limit> <text>         OK <id> <id> ...
+       SALE <cashier> <id>:<qty> ... OK <transactionId> <total> <accepted>/<requested>
+       STOCK <id> <delta>            OK <level>
+       QUIT                          closes the connection
+   Failures answer "ERR <message>". Each worker runs its own epoll loop and all of them wait on the
+   listening socket. Every request already read from a connection is handled before the responses go
+   out in one write, after a single group commit that covers all the sales in the batch. */
+class PosServer {
+private:
+    static const size_t MAX_LINE = 64<<10;
+    static const size_t OUTPUT_LIMIT = (size_t)4<<20; /* stop reading a client that does not drain */
+    struct Connection {
+        int fd;
+        string in, out;
+        bool reading, writing, closing;
+        Connection(int f) : fd(f), reading(true), writing(false), closing(false) {}
+    };
+    SupermarketManager& manager;
+    string path;
+    int listenFd;
+    atomic<size_t> connections, requests;
+    static bool parseInt(string_view& text,int& value){
+        while(!text.empty()&&text.front()==' ') text.remove_prefix(1);
+        auto res=from_chars(text.data(),text.data()+text.size(),value);
+        if(res.ec!=errc()) return false;
+        text.remove_prefix(res.ptr-text.data());
+        return true;
+    }
+    static string_view word(string_view& text){
+        while(!text.empty()&&text.front()==' ') text.remove_prefix(1);
+        size_t end=text.find(' ');
+        string_view w=text.substr(0,end);
+        text.remove_prefix(end==string_view::npos?text.size():end);
+        return w;
+    }
+    static void appendProduct(string& out,const Product& p){
+        out+="OK ";
+        out+=to_string(p.getId());
+        out+=' ';
+        out+=formatCents(p.getPriceCents());
+        out+=' ';
+        out+=to_string(p.getStock());
+        out+=' ';
+        out+=p.getBarcode();
+        out+=' ';
+        out+=p.getName();
+        out+='\n';
+    }
+    /* answers one request line; returns true when it changed durable state */
+    bool handle(string_view line,string& out,int lane,vector<pair<int,int>>& basket,bool& quit){
+        STAT_SCOPE(STAT_REQUEST);
+        requests.fetch_add(1,memory_order_relaxed);
+        if(!line.empty()&&line.back()=='\r') line.remove_suffix(1);
+        string_view rest=line;
+        string_view command=word(rest);
+        try{
+            if(command=="PING"){ out+="OK PONG\n"; return false; }
+            if(command=="FIND"||command=="SCAN"){
+                int id;
+                Product* p=nullptr;
+                if(command=="FIND"){ if(parseInt(rest,id)) p=manager.findProduct(id); }
+                else p=manager.findProductByBarcode(string(word(rest)));
+                if(p) appendProduct(out,*p);
+                else out+="ERR product not found\n";
+                return false;
+            }
+            if(command=="SEARCH"){
+                int limit;
+                if(!parseInt(rest,limit)||limit<1){ out+="ERR usage: SEARCH <limit> <text>\n"; return false; }
+                vector<Product*> found=manager.searchProducts(string(rest),(size_t)min(limit,50));
+                out+="OK";
+                for(Product* p:found){ out+=' '; out+=to_string(p->getId()); }
+                out+='\n';
+                return false;
+            }
+            if(command=="SALE"){
+                int cashier;
+                basket.clear();
+                if(!parseInt(rest,cashier)){ out+="ERR usage: SALE <cashier> <id>:<qty> ...\n"; return false; }
+                while(true){
+                    int id, qty=1;
+                    if(!parseInt(rest,id)) break;
+                    if(!rest.empty()&&rest.front()==':'){
+                        rest.remove_prefix(1);
+                        if(!parseInt(rest,qty)) break;
+                    }
+                    basket.push_back(make_pair(id,qty));
+                }
+                const TransactionRecord& rec=manager.checkout(cashier,basket,lane);
+                out+="OK ";
+                out+=to_string(rec.id);
+                out+=' ';
+                out+=formatCents(rec.total);
+                out+=' ';
+                out+=to_string(rec.itemCount);
+                out+='/';
+                out+=to_string(basket.size());
+                out+='\n';
+                return true;
+            }
+            if(command=="STOCK"){
+                int id, delta;
+                if(!parseInt(rest,id)||!parseInt(rest,delta)){ out+="ERR usage: STOCK <id> <delta>\n"; return false; }
+                int level=manager.updateProductStockQuiet(id,delta);
+                out+="OK "+to_string(level)+"\n";
+                return true;
+            }
+            if(command=="INFO"){
+                out+="OK "+to_string(manager.productCount())+" "+to_string(manager.peekNextProductId())+" "
+                     +to_string(manager.transactionCount())+"\n";
+                return false;
+            }
+            if(command=="QUIT"){ quit=true; return false; }
+            out+="ERR unknown command\n";
+        } catch(const exception& e){
+            out+="ERR ";
+            out+=e.what();
+            out+='\n';
+        }
+        return false;
+    }
+    void watch(int epfd,Connection* c){
+        epoll_event ev{};
+        ev.events=(c->reading?(uint32_t)EPOLLIN:0u)|(c->writing?(uint32_t)EPOLLOUT:0u)|(uint32_t)EPOLLRDHUP;
+        ev.data.ptr=c;
+        epoll_ctl(epfd,EPOLL_CTL_MOD,c->fd,&ev);
+    }
+    /* returns false once the connection should be dropped */
+    bool flushOutput(Connection* c){
+        size_t sent=0;
+        while(sent<c->out.size()){
+            ssize_t n=send(c->fd,c->out.data()+sent,c->out.size()-sent,MSG_NOSIGNAL);
+            if(n<0){
+                if(errno==EINTR) continue;
+                if(errno==EAGAIN||errno==EWOULDBLOCK) break;
+                return false;
+            }
+            sent+=(size_t)n;
+        }
+        c->out.erase(0,sent);
+        return true;
+    }
+    /* reads everything available, answers every complete line, then writes once */
+    bool serviceRead(Connection* c,int lane,vector<pair<int,int>>& basket){
+        char chunk[64<<10];
+        bool eof=false;
+        while(true){
+            ssize_t n=recv(c->fd,chunk,sizeof(chunk),0);
+            if(n>0){ c->in.append(chunk,(size_t)n); if((size_t)n<sizeof(chunk)) break; continue; }
+            if(n==0){ eof=true; break; }
+            if(errno==EINTR) continue;
+            if(errno==EAGAIN||errno==EWOULDBLOCK) break;
+            return false;
+        }
+        bool durable=false, quit=false;
+        size_t start=0;
+        while(!quit){
+            size_t eol=c->in.find('\n',start);
+            if(eol==string::npos) break;
+            durable|=handle(string_view(c->in).substr(start,eol-start),c->out,lane,basket,quit);
+            start=eol+1;
+        }
+        c->in.erase(0,start);
+        if(c->in.size()>MAX_LINE){ c->out+="ERR line too long\n"; quit=true; }
+        if(durable){
+            try{ manager.syncLog(); } catch(const exception&){ return false; }
+        }
+        if(!flushOutput(c)) return false;
+        if(quit||eof) c->closing=true;
+        return !(c->closing&&c->out.empty());
+    }
+    void workerLoop(int lane){
+        int epfd=epoll_create1(0);
+        if(epfd<0) return;
+        epoll_event ev{};
+        ev.events=EPOLLIN|EPOLLEXCLUSIVE;
+        ev.data.ptr=nullptr;
+        epoll_ctl(epfd,EPOLL_CTL_ADD,listenFd,&ev);
+        unordered_map<Connection*,unique_ptr<Connection>> owned;
+        vector<pair<int,int>> basket;
+        epoll_event events[256];
+        auto drop=[&](Connection* c){
+            epoll_ctl(epfd,EPOLL_CTL_DEL,c->fd,nullptr);
+            close(c->fd);
+            owned.erase(c);
+            connections.fetch_sub(1);
+        };
+        while(!serverStopRequested.load()){
+            int n=epoll_wait(epfd,events,256,200);
+            for(int i=0;i<n;i++){
+                Connection* c=(Connection*)events[i].data.ptr;
+                if(!c){
+                    while(true){
+                        int fd=accept4(listenFd,nullptr,nullptr,SOCK_NONBLOCK|SOCK_CLOEXEC);
+                        if(fd<0) break;
+                        Connection* conn=new Connection(fd);
+                        owned[conn].reset(conn);
+                        connections.fetch_add(1);
+                        epoll_event cev{};
+                        cev.events=EPOLLIN|EPOLLRDHUP;
+                        cev.data.ptr=conn;
+                        epoll_ctl(epfd,EPOLL_CTL_ADD,fd,&cev);
+                    }
+                    continue;
+                }
+                bool alive=true;
+                if(events[i].events&(EPOLLERR|EPOLLHUP)) alive=false;
+                if(alive&&(events[i].events&EPOLLOUT)){
+                    alive=flushOutput(c);
+                    if(c->closing&&c->out.empty()) alive=false;
+                }
+                if(alive&&(events[i].events&(EPOLLIN|EPOLLRDHUP))&&c->reading) alive=serviceRead(c,lane,basket);
+                if(!alive){ drop(c); continue; }
+                bool reading=!c->closing&&c->out.size()<OUTPUT_LIMIT, writing=!c->out.empty();
+                if(reading!=c->reading||writing!=c->writing){
+                    c->reading=reading;
+                    c->writing=writing;
+                    watch(epfd,c);
+                }
+            }
+        }
+        for(auto& entry:owned){ close(entry.first->fd); connections.fetch_sub(1); }
+        close(epfd);
+    }
+public:
+    PosServer(SupermarketManager& m,const string& socketPath) : manager(m), path(socketPath), listenFd(-1), connections(0), requests(0) {
+        sockaddr_un addr{};
+        addr.sun_family=AF_UNIX;
+        if(path.size()>=sizeof(addr.sun_path)) throw FileOperationException("Socket path too long: "+path);
+        strcpy(addr.sun_path,path.c_str());
+        ::unlink(path.c_str());
+        listenFd=socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+        if(listenFd<0) throw FileOperationException("Cannot create socket");
+        if(bind(listenFd,(sockaddr*)&addr,sizeof(addr))!=0||listen(listenFd,1024)!=0){
+            close(listenFd);
+            throw FileOperationException("Cannot listen on "+path);
+        }
+    }
+    PosServer(const PosServer&) = delete;
+    PosServer& operator=(const PosServer&) = delete;
+    ~PosServer(){
+        close(listenFd);
+        ::unlink(path.c_str());
+    }
+    /* serves until SIGINT/SIGTERM */
+    void run(int workers){
+        signal(SIGINT,requestServerStop);
+        signal(SIGTERM,requestServerStop);
+        signal(SIGPIPE,SIG_IGN);
+        workers=max(1,workers);
+        cout << BRIGHT_GREEN << "✓ Serving " << manager.productCount() << " products on " << RESET << CYAN << path
+             << RESET << " with " << workers << " event loop(s); Ctrl-C stops" << endl;
+        vector<thread> pool;
+        for(int w=0;w<workers;w++) pool.emplace_back(&PosServer::workerLoop,this,w);
+        for(auto& t:pool) t.join();
+        cout << BRIGHT_GREEN << "✓ Server stopped after " << requests.load() << " requests" << RESET << endl;
+    }
+};
+
+/* A chain of stores, one SupermarketManager shard per store. Products keep their catalog ids in
+   every store, so a SKU id means the same product chain-wide; ids a store mints itself are its own
+   (see joinChain). Chain-wide questions are map-reduce jobs: each worker folds whole stores into a
+   private accumulator and the accumulators are combined at the end */
+class StoreChain {
+public:
+    static const int MAX_STORES = 127;
+    static const int TRANSACTION_BLOCK = 1<<24; /* transaction ids of store s start at s*block+1 */
+    struct Store {
+        string name, source;
+        unique_ptr<SupermarketManager> manager;
+    };
+private:
+    vector<Store> stores;
+    int workers;
+    /* runs body() on n threads, the caller being one of them, and rethrows the first failure */
+    template<typename F>
+    static void runWorkers(int n,F body){
+        exception_ptr failure;
+        mutex failureLock;
+        auto guarded=[&](){
+            try{
+                body();
+            } catch(...){
+                lock_guard<mutex> guard(failureLock);
+                if(!failure) failure=current_exception();
+            }
+        };
+        vector<thread> pool;
+        for(int w=1;w<n;w++) pool.emplace_back(guarded);
+        guarded();
+        for(auto& t:pool) t.join();
+        if(failure) rethrow_exception(failure);
+    }
+    int threadsFor(size_t jobs) const { return (int)max<size_t>(1,min<size_t>(workers,jobs)); }
+public:
+    StoreChain(int threads=0) : workers(threads>0?threads:(int)max(1u,thread::hardware_concurrency())) {}
+    StoreChain(const StoreChain&) = delete;
+    StoreChain& operator=(const StoreChain&) = delete;
+    size_t size() const { return stores.size(); }
+    const string& name(size_t i) const { return stores[i].name; }
+    SupermarketManager& store(size_t i){ return *stores[i].manager; }
+    void setWorkers(int threads){ workers=max(1,threads); }
+    int getWorkers() const { return workers; }
+    /* runs visit(index,store) once per store on up to workers threads */
+    template<typename F>
+    void parallelForEach(F visit){
+        atomic<size_t> next(0);
+        runWorkers(threadsFor(stores.size()),[&](){
+            for(size_t i;(i=next.fetch_add(1))<stores.size();) visit(i,*stores[i].manager);
+        });
+    }
+    /* map(index,store) gives a partial result; reduce(accumulator,partial) folds it in */
+    template<typename R,typename Map,typename Reduce>
+    R mapReduce(const R& identity,Map map,Reduce reduce){
+        int n=threadsFor(stores.size());
+        vector<R> partial(n,identity);
+        atomic<size_t> next(0);
+        atomic<int> slot(0);
+        runWorkers(n,[&](){
+            R& acc=partial[slot.fetch_add(1)];
+            for(size_t i;(i=next.fetch_add(1))<stores.size();) reduce(acc,map(i,*stores[i].manager));
+        });
+        R result=identity;
+        for(auto& part:partial) reduce(result,move(part));
+        return result;
+    }
+    /* each source is a products CSV or a data directory with a snapshot and log; stores load
+       concurrently, one parser thread each. The store count fixes every store's id stride, so a
+       chain is loaded once. Transactions recovered from a data directory keep their ids; only new
+       sales start at index*TRANSACTION_BLOCK+1 */
+    void load(const vector<string>& sources){
+        if(!stores.empty()) throw logic_error("Chain is already loaded");
+        if(sources.size()>(size_t)MAX_STORES) throw invalid_argument("A chain holds at most 127 stores");
+        for(auto& source:sources){
+            Store s;
+            s.source=source;
+            s.name=filesystem::path(source).filename().string();
+            if(filesystem::path(source).extension()==".csv") s.name=filesystem::path(source).stem().string();
+            s.manager.reset(new SupermarketManager());
+            stores.push_back(move(s));
+        }
+        int count=(int)stores.size();
+        for(int i=0;i<count;i++) stores[i].manager->joinChain(i,count,i*TRANSACTION_BLOCK+1);
+        atomic<size_t> next(0);
+        runWorkers(threadsFor(sources.size()),[&](){
+            for(size_t i;(i=next.fetch_add(1))<stores.size();){
+                Store& s=stores[i];
+                if(filesystem::is_directory(s.source)) s.manager->attachStorage(s.source,false);
+                else s.manager->loadProductsFromFile(s.source,false,1);
+            }
+        });
+    }
+    /* every .csv file and every subdirectory of dir, in name order */
+    static vector<string> findSources(const string& dir){
+        vector<string> sources;
+        for(auto& entry:filesystem::directory_iterator(dir))
+            if(entry.is_directory()||entry.path().extension()==".csv") sources.push_back(entry.path().string());
+        sort(sources.begin(),sources.end());
+        return sources;
+    }
+    /* stock queries read one snapshot across every store */
+    long long totalStock(int sku){
+        StockSnapshot snapshot;
+        return mapReduce<long long>(0,
+            [sku,&snapshot](size_t,SupermarketManager& m){ Product* p=m.findProduct(sku); return p?(long long)snapshot.stock(*p):0LL; },
+            [](long long& acc,long long part){ acc+=part; });
+    }
+    /* chain-wide units on hand, indexed by SKU id */
+    vector<long long> stockBySku(){
+        StockSnapshot snapshot;
+        return mapReduce<vector<long long>>(vector<long long>(),
+            [&snapshot](size_t,SupermarketManager& m){
+                vector<long long> units;
+                m.forEachProduct([&units,&snapshot](Product& p){
+                    if((size_t)p.getId()>=units.size()) units.resize((size_t)p.getId()+1,0);
+                    units[p.getId()]+=snapshot.stock(p);
+                });
+                return units;
+            },
+            [](vector<long long>& acc,vector<long long> part){
+                if(part.size()>acc.size()) acc.swap(part);
+                for(size_t i=0;i<part.size();i++) acc[i]+=part[i];
+            });
+    }
+    /* revenue per store (in store order) for sales stamped from..to */
+    vector<Cents> revenueByStore(int64_t from=INT64_MIN,int64_t to=INT64_MAX){
+        vector<Cents> revenue(stores.size(),0);
+        parallelForEach([&revenue,from,to](size_t i,SupermarketManager& m){ revenue[i]=m.revenueBetween(from,to); });
+        return revenue;
+    }
+    void report(int sku=-1){
+        vector<Cents> revenue=revenueByStore();
+        vector<long long> units(stores.size(),0);
+        {
+            StockSnapshot snapshot;
+            parallelForEach([&units,&snapshot](size_t i,SupermarketManager& m){
+                m.forEachProduct([&units,&snapshot,i](Product& p){ units[i]+=snapshot.stock(p); });
+            });
+        }
+        PageWriter w(true);
+        w.put('\n').style(BOLD).style(BG_BLUE).style(WHITE).put("           CHAIN REPORT           ").style(RESET).put('\n');
+        w.style(BOLD).cell("Store",20).cell("Products",10,true).cell("Units",14,true).cell("Sales",10,true)
+         .cell("Revenue",14,true).style(RESET).endRow();
+        Cents totalRevenue=0;
+        long long totalUnits=0;
+        size_t totalProducts=0, totalSales=0;
+        for(size_t i=0;i<stores.size();i++){
+            SupermarketManager& m=*stores[i].manager;
+            w.style(CYAN).cell(stores[i].name,20).style(RESET).cell((long long)m.productCount(),10).cell(units[i],14)
+             .cell((long long)m.transactionCount(),10).style(BRIGHT_GREEN).cell(formatCents(revenue[i]),14,true).style(RESET).endRow();
+            totalRevenue+=revenue[i]; totalUnits+=units[i];
+            totalProducts+=m.productCount(); totalSales+=m.transactionCount();
+        }
+        w.style(BOLD).cell("Chain",20).cell((long long)totalProducts,10).cell(totalUnits,14).cell((long long)totalSales,10)
+         .cell(formatCents(totalRevenue),14,true).style(RESET).endRow();
+        if(sku>=0){
+            w.style(CYAN).put("SKU ").put(to_string(sku)).put(" on hand chain-wide: ").style(RESET)
+             .put(to_string(totalStock(sku))).put('\n');
+        }
+        w.flush();
     }
 };
 
+/* writes a catalog CSV with effectively unlimited stock plus a matching basket log */
+void generateBatchInput(const string& catalogFile,const string& logFile,int productCount,long basketCount,int itemsPerBasket){
+    ofstream catalog(catalogFile);
+    if(!catalog) throw FileOperationException("Cannot open "+catalogFile);
+    catalog<<"ProductID,Name,Price,Stock,Category\n";
+    for(int i=0;i<productCount;i++)
+        catalog<<(1001+i)<<",Item"<<i<<","<<(1+i%50)<<".99,"<<1000000000<<",Category"<<(i%20)<<"\n";
+    catalog.close();
+    ofstream log(logFile);
+    if(!log) throw FileOperationException("Cannot open "+logFile);
+    mt19937 rng(42);
+    uniform_int_distribution<int> pick(0,productCount-1), qty(1,5);
+    string line;
+    for(long b=0;b<basketCount;b++){
+        line="1";
+        for(int i=0;i<itemsPerBasket;i++){
+            line+=' '; line+=to_string(1001+pick(rng));
+            line+=':'; line+=to_string(qty(rng));
+        }
+        line+='\n';
+        log<<line;
+    }
+    log.close();
+    cout << BRIGHT_GREEN << "✓ Generated " << productCount << " products and " << basketCount
+         << " baskets" << RESET << "\n";
+}
+
 void displayMenu(){
     cout << "\n" << BOLD << BRIGHT_CYAN;
     cout << "╔════════════════════════════════════════════╗\n";
@@ -441,21 +4880,32 @@ void displayMenu(){
     cout << "   " << CYAN << "1." << RESET << "  Add Product\n";
     cout << "   " << CYAN << "2." << RESET << "  Display Products\n";
     cout << "   " << CYAN << "3." << RESET << "  Update Product Stock\n";
-    cout << "   " << CYAN << "4." << RESET << "  Generate Product Barcode\n\n";
+    cout << "   " << CYAN << "4." << RESET << "  Generate Product Barcode\n";
+    cout << "   " << CYAN << "13." << RESET << " Generate All Barcodes\n";
+    cout << "   " << CYAN << "22." << RESET << " Verify Labels\n";
+    cout << "   " << CYAN << "20." << RESET << " Search Products\n";
+    cout << "   " << CYAN << "18." << RESET << " Low Stock & Reorder\n\n";
     
     cout << BLUE << "   EMPLOYEES" << RESET << "\n";
     cout << "   " << CYAN << "5." << RESET << "  Add Manager\n";
     cout << "   " << CYAN << "6." << RESET << "  Add Cashier\n";
-    cout << "   " << CYAN << "7." << RESET << "  Display Employees\n\n";
+    cout << "   " << CYAN << "7." << RESET << "  Display Employees\n";
+    cout << "   " << CYAN << "16." << RESET << " Run Payroll\n\n";
     
     cout << GREEN << "   TRANSACTIONS" << RESET << "\n";
     cout << "   " << CYAN << "8." << RESET << "  Process Transaction\n";
-    cout << "   " << CYAN << "9." << RESET << "  Display Transactions\n\n";
+    cout << "   " << CYAN << "9." << RESET << "  Display Transactions\n";
+    cout << "   " << CYAN << "15." << RESET << " Search Transactions\n";
+    cout << "   " << CYAN << "17." << RESET << " Sales Analytics\n";
+    cout << "   " << CYAN << "19." << RESET << " Promotions\n\n";
     
     cout << "   " << BG_BLUE <<"FILE OPERATIONS" << RESET << "\n";
     cout << "   " << CYAN << "10." << RESET << " Save Products to File\n";
     cout << "   " << CYAN << "11." << RESET << " Load Products from File\n";
-    cout << "   " << CYAN << "12." << RESET << " Save Employees to File\n\n";
+    cout << "   " << CYAN << "12." << RESET << " Save Employees to File\n";
+    cout << "   " << CYAN << "14." << RESET << " Checkpoint Storage\n";
+    cout << "   " << CYAN << "23." << RESET << " Export Sales (sales.stxc)\n";
+    cout << "   " << CYAN << "21." << RESET << " Runtime Statistics\n\n";
     
     cout << "   " << RED << "0." << RESET << "  Exit\n\n";
     cout << YELLOW << "➤ Enter choice: " << RESET;
@@ -467,7 +4917,1006 @@ void waitForEnter() {
     cin.get();
 }
 
-int main(){
+volatile long benchmarkSink = 0; /* keeps benchmark loops from being optimised away */
+
+/* compares the old map<int,Product*> inventory against ProductStore at growing catalog sizes */
+void runLookupBenchmark(size_t maxProducts){
+    const size_t LOOKUPS=1000000;
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           PRODUCT LOOKUP BENCHMARK           " << RESET << "\n";
+    cout << left << setw(12) << "SKUs" << setw(16) << "map ns/op" << setw(16) << "store ns/op"
+         << "barcode ns/op\n";
+    for(size_t n=1000;n<=maxProducts;n*=10){
+        mt19937 rng(7);
+        uniform_int_distribution<int> pick(0,(int)n-1);
+        vector<int> ids(LOOKUPS);
+        for(auto& id:ids) id=1001+pick(rng);
+        long checksum=0;
+        double mapNs, storeNs, barcodeNs;
+        {
+            map<int,Product*> legacy;
+            for(size_t i=0;i<n;i++) legacy[1001+(int)i]=new Product(1001+(int)i,"Item",1.99,100,"Category");
+            auto t0=chrono::steady_clock::now();
+            for(int id:ids){
+                auto it=legacy.find(id);
+                if(it!=legacy.end()) checksum+=it->second->getStock();
+            }
+            mapNs=chrono::duration<double,nano>(chrono::steady_clock::now()-t0).count()/LOOKUPS;
+            for(auto& p:legacy) delete p.second;
+        }
+        {
+            ProductStore store;
+            store.reserve(n);
+            for(size_t i=0;i<n;i++) store.insert(Product(1001+(int)i,"Item",1.99,100,"Category"));
+            auto t0=chrono::steady_clock::now();
+            for(int id:ids){
+                Product* p=store.find(id);
+                if(p) checksum+=p->getStock();
+            }
+            storeNs=chrono::duration<double,nano>(chrono::steady_clock::now()-t0).count()/LOOKUPS;
+            vector<string> barcodes(LOOKUPS);
+            for(size_t i=0;i<LOOKUPS;i++) barcodes[i]="PRD"+to_string(ids[i]);
+            t0=chrono::steady_clock::now();
+            for(auto& code:barcodes){
+                Product* p=store.findByBarcode(code);
+                if(p) checksum+=p->getStock();
+            }
+            barcodeNs=chrono::duration<double,nano>(chrono::steady_clock::now()-t0).count()/LOOKUPS;
+        }
+        cout << left << setw(12) << n << fixed << setprecision(1) << setw(16) << mapNs
+             << setw(16) << storeNs << barcodeNs << "\n";
+        benchmarkSink+=checksum;
+    }
+}
+
+size_t residentBytes(){
+    long pages=0, resident=0;
+    FILE* f=fopen("/proc/self/statm","r");
+    if(f){
+        if(fscanf(f,"%ld %ld",&pages,&resident)!=2) resident=0;
+        fclose(f);
+    }
+    return (size_t)resident*(size_t)sysconf(_SC_PAGESIZE);
+}
+
+/* runs build() in a forked child so every layout starts from the same clean heap. build() returns
+   residentBytes() while its structures are still alive; the result is the growth it caused */
+template<typename F>
+size_t measureResident(F build){
+    int fds[2];
+    if(pipe(fds)!=0) throw FileOperationException("Cannot create pipe");
+    pid_t pid=fork();
+    if(pid<0) throw FileOperationException("Cannot fork");
+    if(pid==0){
+        close(fds[0]);
+        size_t before=residentBytes();
+        size_t grown=build()-before;
+        if(write(fds[1],&grown,sizeof(grown))!=(ssize_t)sizeof(grown)) _exit(1);
+        _exit(0);
+    }
+    close(fds[1]);
+    size_t grown=0;
+    if(read(fds[0],&grown,sizeof(grown))!=(ssize_t)sizeof(grown)) grown=0;
+    close(fds[0]);
+    waitpid(pid,nullptr,0);
+    return grown;
+}
+
+/* resident memory of a catalog held three ways: the original heap-allocated products with string
+   fields in a map, the same records in ProductStore chunks with a barcode index, and the compact
+   records (arena names, interned categories, derived barcodes) */
+void runMemoryBenchmark(size_t products){
+    struct StringProduct {
+        int productId;
+        string name;
+        Cents price;
+        atomic<int> stock;
+        string category;
+        string barcode;
+    };
+    const char* words[]={"Organic","Whole","Milk","Bread","Apple","Cheddar","Cheese","Green","Tea","Coffee",
+                         "Roasted","Chicken","Fresh","Orange","Juice","Butter","Greek","Yogurt","Pasta","Rice"};
+    auto nameOf=[&words](size_t i){
+        return string(words[i%20])+" "+words[i/20%20]+" "+words[i/400%20]+" "+to_string(100+i%900)+"g";
+    };
+    auto categoryOf=[](size_t i){ return "Aisle "+to_string(i%48); };
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           PRODUCT MEMORY BENCHMARK           " << RESET << "\n";
+    cout << CYAN << "Building " << RESET << products << CYAN << " SKUs per layout in a fresh process..." << RESET << endl;
+    size_t legacy=measureResident([&](){
+        map<int,StringProduct*> inventory;
+        for(size_t i=0;i<products;i++){
+            int id=1001+(int)i;
+            StringProduct* p=new StringProduct();
+            p->productId=id; p->name=nameOf(i); p->price=199; p->stock=100;
+            p->category=categoryOf(i); p->barcode="PRD"+to_string(id);
+            inventory[id]=p;
+        }
+        benchmarkSink+=(long)inventory.size();
+        return residentBytes();
+    });
+    size_t chunked=measureResident([&](){
+        ChunkedArray<StringProduct> slots;
+        ChunkedArray<int> slotById;
+        vector<uint32_t> barcodes;
+        size_t buckets=1024;
+        while(buckets<products*2) buckets*=2;
+        barcodes.assign(buckets,0);
+        slots.ensure(products);
+        slotById.ensure(products+1001,-1);
+        for(size_t i=0;i<products;i++){
+            StringProduct& p=slots[i];
+            p.productId=1001+(int)i; p.name=nameOf(i); p.price=199; p.stock=100;
+            p.category=categoryOf(i); p.barcode="PRD"+to_string(p.productId);
+            slotById[p.productId]=(int)i;
+            size_t b=fnv1a(p.barcode.data(),p.barcode.size())&(buckets-1);
+            while(barcodes[b]) b=(b+1)&(buckets-1);
+            barcodes[b]=(uint32_t)i+1;
+        }
+        benchmarkSink+=slots[products/2].productId;
+        return residentBytes();
+    });
+    size_t compact=measureResident([&](){
+        ProductStore store;
+        store.reserve(products);
+        for(size_t i=0;i<products;i++) store.insert(Product(1001+(int)i,nameOf(i),1.99,100,categoryOf(i)));
+        benchmarkSink+=(long)store.size();
+        return residentBytes();
+    });
+    auto row=[products,legacy](const char* label,size_t bytes){
+        cout << "  " << left << setw(36) << label << right << fixed << setprecision(1) << setw(9) << bytes/1048576.0
+             << " MB" << setw(8) << (double)bytes/max<size_t>(1,products) << " B/SKU" << setw(8)
+             << (bytes?(double)legacy/bytes:0) << "x smaller\n";
+    };
+    row("new + map, string fields",legacy);
+    row("chunked store, string fields",chunked);
+    row("chunked store, compact records",compact);
+    cout << CYAN << "sizeof(Product): " << RESET << sizeof(Product) << CYAN << " bytes, was " << RESET
+         << sizeof(StringProduct) << "\n";
+}
+
+/* writes one catalog per store under bench_chain/, then for 1..all cores loads the chain, checks
+   out baskets in every store and runs the chain-wide queries */
+void runChainBenchmark(int storeCount,size_t productsPerStore,long basketsPerStore){
+    string dir="bench_chain";
+    filesystem::create_directories(dir);
+    vector<string> sources;
+    for(int s=0;s<storeCount;s++){
+        string file=dir+"/store"+to_string(100+s).substr(1)+".csv";
+        ofstream out(file);
+        out<<"ProductID,Name,Price,Stock,Category\n";
+        mt19937 rng(s+1);
+        for(size_t i=0;i<productsPerStore;i++)
+            out<<1001+i<<",Item"<<i<<","<<formatCents(199+(Cents)(i%5000))<<","<<100+rng()%500<<",Category"<<i%48<<"\n";
+        sources.push_back(file);
+    }
+    int cores=(int)max(1u,thread::hardware_concurrency());
+    vector<int> threadCounts;
+    for(int t=1;t<cores;t*=2) threadCounts.push_back(t);
+    threadCounts.push_back(cores);
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           STORE CHAIN BENCHMARK           " << RESET << "\n";
+    cout << CYAN << storeCount << " stores x " << productsPerStore << " SKUs, " << basketsPerStore
+         << " baskets of 10 per store" << RESET << "\n";
+    cout << left << setw(9) << "threads" << setw(12) << "load s" << setw(16) << "baskets/s" << setw(16)
+         << "stock/SKU ms" << setw(14) << "revenue ms" << "speedup (load, sales, stock, revenue)\n";
+    double base[4]={0,0,0,0};
+    for(int threads:threadCounts){
+        StoreChain chain(threads);
+        auto t0=chrono::steady_clock::now();
+        chain.load(sources);
+        double load=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        t0=chrono::steady_clock::now();
+        chain.parallelForEach([basketsPerStore,productsPerStore](size_t i,SupermarketManager& m){
+            int cashier=m.addCashierQuiet("Chain Cashier","000-000-00-00",2000).getId();
+            mt19937 rng((unsigned)i+7);
+            uniform_int_distribution<int> pick(0,(int)productsPerStore-1);
+            vector<pair<int,int>> basket(10);
+            for(long b=0;b<basketsPerStore;b++){
+                for(auto& item:basket) item=make_pair(1001+pick(rng),1);
+                m.checkout(cashier,basket);
+            }
+        });
+        double sales=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        t0=chrono::steady_clock::now();
+        vector<long long> units=chain.stockBySku();
+        double stock=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+        t0=chrono::steady_clock::now();
+        vector<Cents> revenue=chain.revenueByStore();
+        double revenueMs=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+        benchmarkSink+=(long)(units.empty()?0:units.back())+(long)(revenue.empty()?0:revenue[0]);
+        double row[4]={load,sales,stock,revenueMs};
+        if(threads==1) copy(row,row+4,base);
+        cout << left << setw(9) << threads << fixed << setprecision(3) << setw(12) << load << setprecision(0)
+             << setw(16) << storeCount*basketsPerStore/max(sales,1e-9) << setprecision(2) << setw(16) << stock
+             << setw(14) << revenueMs << setprecision(2) << base[0]/load << "x "
+             << base[1]/max(sales,1e-9) << "x " << base[2]/max(stock,1e-9) << "x " << base[3]/max(revenueMs,1e-9) << "x\n";
+    }
+}
+
+/* checkout latency while a full-catalog export runs beside it. Two stores share every SKU id, as in
+   a chain, and start from different stock levels. Every basket takes one unit each of products a
+   and a+N/2 in one store, so in any consistent view the two halves of a store's catalog match and
+   no level is above the store's starting stock; an export that sees otherwise has read a basket
+   half applied or another store's level */
+void runSnapshotBenchmark(int productCount,double seconds){
+    const int STORES=2;
+    const int START[STORES]={1000000000,500000000};
+    SupermarketManager stores[STORES];
+    int cashier[STORES];
+    for(int s=0;s<STORES;s++){
+        for(int i=0;i<productCount;i++)
+            stores[s].addProductQuiet("Item"+to_string(i),1.99,START[s],"Category"+to_string(i%20));
+        cashier[s]=stores[s].addCashierQuiet("Bench Cashier","000-000-00-00",2000).getId();
+    }
+    {
+        SupermarketManager a, b; /* same SKU in two stores, both written while a snapshot is open */
+        Product& x=a.addProductQuiet("Shared",1.0,50,"Check");
+        Product& y=b.addProductQuiet("Shared",1.0,70,"Check");
+        int seenX, seenY;
+        {
+            StockSnapshot snapshot;
+            x.reduceStock(1);
+            y.reduceStock(1);
+            seenX=snapshot.stock(x);
+            seenY=snapshot.stock(y);
+        }
+        bool ok=x.getId()==y.getId()&&seenX==50&&seenY==70&&x.getStock()==49&&y.getStock()==69;
+        cout << (ok?GREEN:RED) << (ok?"✓":"✗") << " Same SKU in two stores: snapshot read " << seenX << " and " << seenY
+             << " (expected 50 and 70)" << RESET << "\n";
+    }
+    int half=productCount/2;
+    int lanes=(int)max(2u,thread::hardware_concurrency());
+    shared_mutex catalogLock;
+    const char* names[]={"no export","export under a lock","export, live reads","export from a snapshot"};
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           SNAPSHOT EXPORT BENCHMARK           " << RESET << "\n";
+    cout << CYAN << STORES << " stores x " << productCount << " SKUs, " << lanes << " checkout lanes, " << seconds
+         << "s per run" << RESET << "\n";
+    cout << left << setw(26) << "run" << setw(12) << "baskets/s" << setw(10) << "p50 us" << setw(10) << "p99 us"
+         << setw(12) << "p99.9 us" << setw(10) << "exports" << "bad reads\n";
+    for(int mode=0;mode<4;mode++){
+        atomic<bool> stop(false);
+        vector<vector<double>> latencies(lanes);
+        vector<thread> workers;
+        for(int lane=0;lane<lanes;lane++)
+            workers.emplace_back([&,lane](){
+                SupermarketManager& store=stores[lane%STORES];
+                int who=cashier[lane%STORES];
+                mt19937 rng(lane+1);
+                uniform_int_distribution<int> pick(0,half-1);
+                vector<pair<int,int>> basket(2);
+                while(!stop.load(memory_order_relaxed)){
+                    int a=1001+pick(rng);
+                    basket[0]=make_pair(a,1);
+                    basket[1]=make_pair(a+half,1);
+                    auto t0=chrono::steady_clock::now();
+                    if(mode==1){
+                        shared_lock<shared_mutex> guard(catalogLock);
+                        store.checkout(who,basket,lane);
+                    } else store.checkout(who,basket,lane);
+                    latencies[lane].push_back(chrono::duration<double,micro>(chrono::steady_clock::now()-t0).count());
+                }
+            });
+        long exports=0, bad=0;
+        vector<int> seen((size_t)STORES*productCount);
+        auto start=chrono::steady_clock::now();
+        auto end=start+chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+        while(chrono::steady_clock::now()<end){
+            if(mode==0){ this_thread::sleep_for(chrono::milliseconds(10)); continue; }
+            ofstream out("/dev/null");
+            for(int s=0;s<STORES;s++){
+                int* row=&seen[(size_t)s*productCount];
+                auto visit=[row,&out](Product& p,int stock){ row[p.getId()-1001]=stock; p.saveToFile(out,stock); };
+                if(mode==1){
+                    unique_lock<shared_mutex> guard(catalogLock);
+                    stores[s].forEachProduct([&visit](Product& p){ visit(p,p.getStock()); });
+                } else if(mode==2) stores[s].forEachProduct([&visit](Product& p){ visit(p,p.getStock()); });
+                else {
+                    StockSnapshot snapshot;
+                    stores[s].forEachProduct([&visit,&snapshot](Product& p){ visit(p,snapshot.stock(p)); });
+                }
+            }
+            for(int s=0;s<STORES;s++){
+                const int* row=&seen[(size_t)s*productCount];
+                for(int i=0;i<half;i++) if(row[i]!=row[i+half]||row[i]>START[s]) bad++;
+            }
+            exports++;
+        }
+        stop=true;
+        for(auto& w:workers) w.join();
+        double elapsed=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        vector<double> all;
+        for(auto& l:latencies) all.insert(all.end(),l.begin(),l.end());
+        sort(all.begin(),all.end());
+        auto pct=[&all](double q){ return all.empty()?0:all[(size_t)(q*(all.size()-1))]; };
+        cout << left << setw(26) << names[mode] << fixed << setprecision(0) << setw(12) << all.size()/elapsed
+             << setprecision(1) << setw(10) << pct(0.50) << setw(10) << pct(0.99) << setw(12) << pct(0.999)
+             << setw(10) << exports << bad << "\n";
+    }
+}
+
+/* a month of synthetic sales exported as CSV and as columns, then the same revenue-by-product query
+   answered from each, plus single-column and one-day scans of the columnar file */
+void runColumnarBenchmark(long baskets){
+    const int PRODUCTS=5000, CASHIERS=20, LANES=8;
+    TransactionJournal journal;
+    mt19937 rng(42);
+    vector<Cents> price(PRODUCTS);
+    for(auto& c:price) c=99+(Cents)(rng()%2000);
+    int64_t start=parseTimestamp("2024-05-01");
+    vector<LineItem> lines;
+    for(long b=0;b<baskets;b++){
+        lines.resize(1+rng()%12);
+        for(auto& line:lines){
+            double u=(rng()%1000000)/1e6;
+            int product=(int)(PRODUCTS*u*u*u); /* a few products sell most */
+            line=LineItem{1001+product,1+(int)(rng()%8==0?rng()%5:0),price[product],0};
+        }
+        journal.append((int)(b%LANES),1+(int)(rng()%CASHIERS),lines,0,0,start+b*(30*86400LL)/baskets);
+    }
+    string csv="bench_sales.csv", columnar="bench_sales.stxc";
+    auto seconds=[](chrono::steady_clock::time_point t0){ return chrono::duration<double>(chrono::steady_clock::now()-t0).count(); };
+    auto t0=chrono::steady_clock::now();
+    size_t rows=SupermarketManager::writeSales(journal,csv,INT64_MIN,INT64_MAX);
+    double csvWrite=seconds(t0);
+    t0=chrono::steady_clock::now();
+    SupermarketManager::writeSales(journal,columnar,INT64_MIN,INT64_MAX);
+    double columnarWrite=seconds(t0);
+    vector<Cents> csvRevenue(1001+PRODUCTS,0), columnRevenue(1001+PRODUCTS,0);
+    t0=chrono::steady_clock::now();
+    {
+        MappedFile file(csv);
+        const char* p=(const char*)memchr(file.begin(),'\n',file.size())+1;
+        while(p<file.end()){
+            const char* eol=(const char*)memchr(p,'\n',file.end()-p);
+            for(int field=0;field<3;field++) p=(const char*)memchr(p,',',eol-p)+1;
+            int product=0, quantity=0;
+            long long dollars=0, cents=0;
+            p=from_chars(p,eol,product).ptr+1;
+            p=from_chars(p,eol,quantity).ptr+1;
+            p=from_chars(p,eol,dollars).ptr+1;
+            from_chars(p,eol,cents);
+            csvRevenue[product]+=(dollars*100+cents)*quantity;
+            p=eol+1;
+        }
+    }
+    double csvScan=seconds(t0);
+    SalesColumnReader reader(columnar);
+    t0=chrono::steady_clock::now();
+    reader.scan(SALES_PRODUCT|SALES_QUANTITY|SALES_PRICE,[&columnRevenue](const SalesColumnReader::Block& b){
+        for(size_t i=0;i<b.rows;i++) columnRevenue[b.productIds[i]]+=b.unitPrices[i]*b.quantities[i];
+    });
+    double columnScan=seconds(t0);
+    long units=0;
+    t0=chrono::steady_clock::now();
+    reader.scan(SALES_QUANTITY,[&units](const SalesColumnReader::Block& b){
+        for(size_t i=0;i<b.rows;i++) units+=b.quantities[i];
+    });
+    double unitScan=seconds(t0);
+    Cents dayRevenue=0;
+    t0=chrono::steady_clock::now();
+    size_t dayRows=reader.scan(SALES_QUANTITY|SALES_PRICE,[&dayRevenue](const SalesColumnReader::Block& b){
+        for(size_t i=0;i<b.rows;i++) dayRevenue+=b.unitPrices[i]*b.quantities[i];
+    },start+14*86400,start+15*86400-1);
+    double dayScan=seconds(t0);
+    benchmarkSink+=units+(long)dayRevenue;
+    double csvBytes=(double)filesystem::file_size(csv), columnBytes=(double)reader.fileSize();
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           COLUMNAR EXPORT BENCHMARK           " << RESET << "\n";
+    cout << CYAN << baskets << " baskets over 30 days, " << rows << " sale lines, " << PRODUCTS << " products" << RESET << "\n";
+    cout << left << setw(34) << "" << setw(14) << "CSV" << setw(14) << "columnar" << "ratio\n" << fixed;
+    cout << left << setw(34) << "file MB" << setprecision(2) << setw(14) << csvBytes/1e6 << setw(14) << columnBytes/1e6
+         << setprecision(1) << csvBytes/columnBytes << "x smaller\n";
+    cout << left << setw(34) << "export ms" << setprecision(1) << setw(14) << csvWrite*1e3 << setw(14) << columnarWrite*1e3
+         << setprecision(2) << csvWrite/columnarWrite << "x\n";
+    cout << left << setw(34) << "revenue by product ms" << setprecision(1) << setw(14) << csvScan*1e3 << setw(14)
+         << columnScan*1e3 << setprecision(1) << csvScan/columnScan << "x faster\n";
+    cout << left << setw(34) << "units sold (one column) ms" << setw(14) << "-" << setprecision(1) << setw(14) << unitScan*1e3 << "\n";
+    cout << left << setw(34) << "one day's revenue ms" << setw(14) << "-" << setw(14) << dayScan*1e3 << dayRows << " lines\n";
+    cout << (csvRevenue==columnRevenue?GREEN:RED) << (csvRevenue==columnRevenue?"✓ Both files give the same revenue by product":"✗ Revenue differs between the files") << RESET << "\n";
+    filesystem::remove(csv);
+    filesystem::remove(columnar);
+}
+
+/* gross sales in a columnar export, optionally limited to from..to, with the ten top-grossing products */
+void printSalesSummary(const string& filename,int64_t from,int64_t to){
+    auto start=chrono::steady_clock::now();
+    SalesColumnReader reader(filename);
+    unordered_map<int,Cents> byProduct;
+    long transactions=0, units=0;
+    int32_t lastTransaction=INT32_MIN;
+    Cents revenue=0;
+    size_t lines=reader.scan(SALES_TRANSACTION|SALES_PRODUCT|SALES_QUANTITY|SALES_PRICE,[&](const SalesColumnReader::Block& b){
+        for(size_t i=0;i<b.rows;i++){
+            if(b.transactionIds[i]!=lastTransaction){ transactions++; lastTransaction=b.transactionIds[i]; }
+            Cents amount=b.unitPrices[i]*b.quantities[i];
+            units+=b.quantities[i];
+            revenue+=amount;
+            byProduct[b.productIds[i]]+=amount;
+        }
+    },from,to);
+    vector<pair<Cents,int>> top;
+    for(auto& entry:byProduct) top.push_back(make_pair(entry.second,entry.first));
+    size_t shown=min<size_t>(10,top.size());
+    partial_sort(top.begin(),top.begin()+shown,top.end(),[](const pair<Cents,int>& a,const pair<Cents,int>& b){
+        return a.first>b.first||(a.first==b.first&&a.second<b.second);
+    });
+    double elapsed=chrono::duration<double,milli>(chrono::steady_clock::now()-start).count();
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           SALES EXPORT SUMMARY           " << RESET << "\n";
+    cout << CYAN << "Lines: " << RESET << lines << CYAN << " | Transactions: " << RESET << transactions
+         << CYAN << " | Units: " << RESET << units << CYAN << " | Gross: " << RESET << BRIGHT_GREEN << "$" << formatCents(revenue) << RESET << "\n";
+    for(size_t i=0;i<shown;i++)
+        cout << "  " << left << setw(4) << i+1 << CYAN << "Product " << RESET << setw(10) << top[i].second
+             << GREEN << "$" << formatCents(top[i].first) << RESET << "\n";
+    cout << CYAN << "Scanned " << filesystem::file_size(filename) << " bytes in " << RESET << fixed << setprecision(2) << elapsed << " ms\n";
+}
+
+/* builds a store under dir from a catalog, logs a day of sales on top, then times a cold restart */
+void runRecoveryBenchmark(const string& catalogFile,const string& dir,long baskets){
+    filesystem::remove(dir+"/stox.snap");
+    filesystem::remove(dir+"/stox.wal");
+    size_t productCount;
+    {
+        SupermarketManager manager;
+        manager.attachStorage(dir,false);
+        manager.loadProductsFromFile(catalogFile);
+        manager.addCashier("Batch Cashier","000-000-00-00",2000);
+        productCount=manager.productCount();
+        mt19937 rng(11);
+        uniform_int_distribution<int> pick(0,(int)productCount-1);
+        vector<pair<int,int>> basket(10);
+        long logged=0;
+        auto t0=chrono::steady_clock::now();
+        for(long b=0;b<baskets;b++){
+            for(auto& item:basket) item=make_pair(1001+pick(rng),1);
+            try{
+                manager.checkout(1,basket);
+                logged++;
+            } catch(const EmptyTransactionException&){ /* a small catalog can sell out */
+            }
+        }
+        manager.flushStorage();
+        double elapsed=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        cout << CYAN << "Logged " << RESET << logged << CYAN << " baskets with group commit in " << RESET
+             << fixed << setprecision(3) << elapsed << "s\n";
+    }
+    auto t0=chrono::steady_clock::now();
+    SupermarketManager restarted;
+    restarted.attachStorage(dir,false);
+    double elapsed=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+    cout << BRIGHT_CYAN << "Cold restart of " << productCount << " SKUs: " << RESET << BRIGHT_GREEN
+         << fixed << setprecision(3) << elapsed << "s" << RESET << "\n";
+}
+
+/* virtual calculateSalary() per employee against the columnar payroll pass, checking both agree */
+void runPayrollBenchmark(int staffCount){
+    EmployeeRegistry registry;
+    mt19937 rng(5);
+    uniform_int_distribution<int> salary(1500,9000), txs(0,20000);
+    for(int id=1;id<=staffCount;id++){
+        if(id%10==0) registry.add(new Manager("Manager"+to_string(id),id,"",salary(rng)+0.25,salary(rng)/7.0));
+        else{
+            registry.add(new Cashier("Cashier"+to_string(id),id,"",salary(rng)+0.75));
+            registry.setTransactionCount(id,txs(rng));
+        }
+    }
+    const int ROUNDS=20;
+    vector<double> virtualTotals(staffCount);
+    double virtualSum=0;
+    auto t0=chrono::steady_clock::now();
+    for(int r=0;r<ROUNDS;r++){
+        const vector<Employee*>& staff=registry.all();
+        virtualSum=0;
+        for(size_t i=0;i<staff.size();i++){
+            virtualTotals[i]=staff[i]->calculateSalary();
+            virtualSum+=virtualTotals[i];
+        }
+    }
+    double virtualMs=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count()/ROUNDS;
+    EmployeeRegistry::PayrollSummary pay;
+    t0=chrono::steady_clock::now();
+    for(int r=0;r<ROUNDS;r++) pay=registry.runPayroll();
+    double columnMs=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count()/ROUNDS;
+    size_t mismatches=0;
+    for(int i=0;i<staffCount;i++) if(memcmp(&virtualTotals[i],&pay.totals[i],sizeof(double))!=0) mismatches++;
+    cout << "\n" << BOLD << BG_GREEN << WHITE << "           PAYROLL BENCHMARK           " << RESET << "\n";
+    cout << CYAN << "Employees: " << RESET << staffCount << "\n" << fixed << setprecision(3)
+         << CYAN << "Virtual calculateSalary(): " << RESET << virtualMs << " ms, total $" << setprecision(2) << virtualSum << "\n"
+         << setprecision(3) << CYAN << "Columnar payroll pass:     " << RESET << columnMs << " ms, total $"
+         << setprecision(2) << pay.grandTotal << "\n"
+         << CYAN << "Per-employee mismatches: " << RESET << (mismatches?RED:BRIGHT_GREEN) << mismatches << RESET << "\n";
+}
+
+/* query latency of the running totals as history grows; it should not move with transaction count */
+void runAnalyticsBenchmark(int productCount,long maxBaskets){
+    SupermarketManager manager;
+    for(int i=0;i<productCount;i++)
+        manager.addProductQuiet("Item"+to_string(i),1+i%50+0.99,1000000000,"Category"+to_string(i%20));
+    manager.addCashier("Batch Cashier","000-000-00-00",2000);
+    mt19937 rng(3);
+    uniform_int_distribution<int> pick(0,productCount-1);
+    vector<pair<int,int>> basket(10);
+    SalesAnalytics& analytics=manager.getAnalytics();
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           ANALYTICS QUERY BENCHMARK           " << RESET << "\n";
+    cout << left << setw(16) << "Transactions" << setw(16) << "top10 ns" << setw(16) << "category ns" << "product ns\n";
+    long done=0;
+    for(long target=1000;target<=maxBaskets;target*=10){
+        for(;done<target;done++){
+            for(auto& item:basket) item=make_pair(1001+pick(rng),1+(int)(done%3));
+            manager.checkout(1,basket);
+        }
+        const int QUERIES=10000;
+        int64_t sink=0;
+        auto t0=chrono::steady_clock::now();
+        for(int q=0;q<QUERIES;q++) sink+=analytics.topSellers(10).size();
+        double topNs=chrono::duration<double,nano>(chrono::steady_clock::now()-t0).count()/QUERIES;
+        t0=chrono::steady_clock::now();
+        for(int q=0;q<QUERIES;q++) sink+=analytics.byCategory().size();
+        double categoryNs=chrono::duration<double,nano>(chrono::steady_clock::now()-t0).count()/QUERIES;
+        t0=chrono::steady_clock::now();
+        for(int q=0;q<QUERIES;q++) sink+=analytics.product(1001+pick(rng)).units;
+        double productNs=chrono::duration<double,nano>(chrono::steady_clock::now()-t0).count()/QUERIES;
+        benchmarkSink+=sink;
+        cout << left << setw(16) << done << fixed << setprecision(1) << setw(16) << topNs
+             << setw(16) << categoryNs << productNs << "\n";
+    }
+}
+
+/* prices random baskets against a mix of multi-buy, bundle and category rules */
+void runPricingBenchmark(int promotions,int basketItems){
+    const int PRODUCTS=100000, CATEGORIES=50, BASKETS=100000;
+    PricingEngine pricing;
+    for(int id=0;id<PRODUCTS;id++) pricing.registerProduct(id,"Category"+to_string(id%CATEGORIES));
+    mt19937 rng(12);
+    uniform_int_distribution<int> hot(0,PRODUCTS/10-1);
+    auto start=chrono::steady_clock::now();
+    for(int i=0;i<promotions;i++){
+        PricingEngine::Rule rule;
+        if(i%10<6){
+            rule.kind=PricingEngine::MULTI_BUY;
+            rule.productId=hot(rng); rule.buy=1+i%3; rule.get=1;
+        } else if(i%10<9){
+            rule.kind=PricingEngine::BUNDLE;
+            for(int k=0;k<2+i%2;k++) rule.products.push_back(hot(rng));
+            rule.bundlePrice=100+i%400;
+            if(rule.products[0]==rule.products[1]) continue;
+        } else{
+            rule.kind=PricingEngine::CATEGORY_PERCENT;
+            rule.category="Category"+to_string(i%CATEGORIES);
+            rule.basisPoints=500+i%2000;
+        }
+        pricing.addRule(rule);
+    }
+    double compileMs=chrono::duration<double,milli>(chrono::steady_clock::now()-start).count();
+    vector<vector<LineItem>> baskets(64);
+    for(auto& basket:baskets)
+        for(int i=0;i<basketItems;i++){
+            int id=hot(rng);
+            basket.push_back(LineItem{id,1+(int)(rng()%4),99+id%900,0});
+        }
+    Cents saved=0;
+    start=chrono::steady_clock::now();
+    for(int b=0;b<BASKETS;b++) saved+=pricing.apply(baskets[b&63]);
+    double perBasket=chrono::duration<double,micro>(chrono::steady_clock::now()-start).count()/BASKETS;
+    benchmarkSink+=saved;
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           PRICING BENCHMARK           " << RESET << "\n";
+    cout << CYAN << "Rules: " << RESET << pricing.getRules().size() << CYAN << ", basket lines: " << RESET << basketItems
+         << CYAN << ", added in " << RESET << fixed << setprecision(2) << compileMs << " ms (one recompile per rule)\n";
+    cout << CYAN << "Per basket: " << RESET << BRIGHT_GREEN << perBasket << " us" << RESET
+         << CYAN << ", average saving: " << RESET << "$" << formatCents(saved/BASKETS) << "\n";
+}
+
+/* reorder listing through the index vs a full catalog scan, with 0.1% of products running low */
+void runLowStockBenchmark(int maxProducts){
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           LOW STOCK QUERY BENCHMARK           " << RESET << "\n";
+    cout << left << setw(12) << "Products" << setw(10) << "Low" << setw(16) << "index us" << "scan us\n";
+    for(int n=1000;n<=maxProducts;n*=10){
+        SupermarketManager manager;
+        for(int i=0;i<n;i++)
+            manager.addProductQuiet("Item"+to_string(i),1.99,i%1000==0?5:1000,"Category"+to_string(i%20));
+        const int QUERIES=n<=100000?100:10;
+        size_t low=0;
+        auto t0=chrono::steady_clock::now();
+        for(int q=0;q<QUERIES;q++) low=manager.reorderSuggestions().size();
+        double indexUs=chrono::duration<double,micro>(chrono::steady_clock::now()-t0).count()/QUERIES;
+        long scanned=0;
+        t0=chrono::steady_clock::now();
+        for(int q=0;q<QUERIES;q++)
+            for(int id=1001;id<1001+n;id++){
+                Product* p=manager.findProduct(id);
+                if(p&&p->getStock()<LowStockIndex::DEFAULT_THRESHOLD) scanned++;
+            }
+        double scanUs=chrono::duration<double,micro>(chrono::steady_clock::now()-t0).count()/QUERIES;
+        benchmarkSink+=scanned;
+        cout << left << setw(12) << n << setw(10) << low << fixed << setprecision(1) << setw(16) << indexUs << scanUs << "\n";
+    }
+}
+
+/* prefix, typo and two-word queries against a catalog of brand + product + variant + size names */
+void runSearchBenchmark(int maxProducts){
+    const char* brands[]={"Atena","Milla","Sevimli","Gilan","Gənclik","Bizim Tarla","Az-Granata","Nestle","Danone","Sirab",
+                          "Badamlı","Xan Çay","Azərçay","Qızıl Quyu","Pərvanə","Ulduz","Zəfər","Kəndli","Dadlı","Bərəkət"};
+    const char* goods[]={"Süd","Çörək","Şəkər","Yağ","Pendir","Qatıq","Kəsmik","Alma","Armud","Üzüm","Çay","Qəhvə",
+                         "Un","Düyü","Makaron","Yumurta","Kolbasa","Sosiska","Toyuq","Mal əti","Balıq","Şokolad","Peçenye",
+                         "Su","Limonad","Şirə","Kompot","Mürəbbə","Bal","Duz","Milk","Bread","Cheese","Butter","Yogurt",
+                         "Coffee","Tea","Rice","Pasta","Chocolate","Biscuit","Juice","Water","Honey","Apple","Tomato"};
+    const char* variants[]={"Klassik","Təbii","Premium","Ev","Kənd","Light","Extra","Organic","Qaymaqlı","Şirin","Acı","Təzə"};
+    const char* sizes[]={"100g","250g","500g","1kg","2kg","0.5l","1l","1.5l","2l","5l"};
+    const char* prefixQueries[]={"sü","çör","mil","pen","şok","qəh","bis","ate","azər","kənd"};
+    const char* typoQueries[]={"seker","chese","pendr","shokolad","yogurd","biskuit","limonat","qahve","kolbas","muraba"};
+    const char* pairQueries[]={"atena süd","milla pendir","sevimli çay","nestle coffee","gilan qəhvə",
+                               "danone yogurt","sirab su","xan çay","ulduz un","dadlı bal"};
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           PRODUCT SEARCH BENCHMARK           " << RESET << "\n";
+    cout << left << setw(12) << "Products" << setw(10) << "Tokens" << setw(22) << "prefix p50/p99 us"
+         << setw(22) << "typo p50/p99 us" << "two-word p50/p99 us\n";
+    SupermarketManager manager;
+    mt19937 rng(13);
+    int added=0;
+    for(int target=1000;target<=maxProducts;target*=10){
+        for(;added<target;added++){
+            string name=string(brands[rng()%20])+" "+goods[rng()%46]+" "+variants[rng()%12]+" "+sizes[rng()%10];
+            manager.addProductQuiet(name,1+rng()%5000/100.0,100,"Category"+to_string(added%50));
+        }
+        ProductSearchIndex& index=manager.getSearchIndex();
+        auto measure=[&index](const char* const* queries){
+            vector<double> latencies;
+            size_t sink=0;
+            for(int round=0;round<20;round++)
+                for(int q=0;q<10;q++){
+                    auto t0=chrono::steady_clock::now();
+                    sink+=index.search(queries[q],10).size();
+                    latencies.push_back(chrono::duration<double,micro>(chrono::steady_clock::now()-t0).count());
+                }
+            benchmarkSink+=sink;
+            sort(latencies.begin(),latencies.end());
+            ostringstream text;
+            text << fixed << setprecision(1) << latencies[latencies.size()/2] << "/" << latencies[latencies.size()*99/100];
+            return text.str();
+        };
+        string prefix=measure(prefixQueries), typo=measure(typoQueries), pairs=measure(pairQueries);
+        cout << left << setw(12) << target << setw(10) << index.tokenCount() << setw(22) << prefix
+             << setw(22) << typo << pairs << "\n";
+    }
+}
+
+/* drives a --serve instance over many connections, each keeping pipeline requests in flight:
+   70% FIND, 20% SALE of 1-5 lines, 10% SEARCH. Latency runs from send to response line. */
+void runLoadGenerator(const string& socketPath,int connectionCount,double seconds,int pipeline){
+    struct Client {
+        int fd;
+        string in, out;
+        deque<chrono::steady_clock::time_point> sent;
+    };
+    sockaddr_un addr{};
+    addr.sun_family=AF_UNIX;
+    if(socketPath.size()>=sizeof(addr.sun_path)) throw FileOperationException("Socket path too long: "+socketPath);
+    strcpy(addr.sun_path,socketPath.c_str());
+    signal(SIGPIPE,SIG_IGN);
+    int epfd=epoll_create1(0);
+    vector<Client> clients(max(1,connectionCount));
+    for(auto& c:clients){
+        c.fd=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+        if(c.fd<0||connect(c.fd,(sockaddr*)&addr,sizeof(addr))!=0)
+            throw FileOperationException("Cannot connect to "+socketPath);
+    }
+    /* product id range from the server itself */
+    string info="INFO\n", reply;
+    char buf[4096];
+    if(send(clients[0].fd,info.data(),info.size(),MSG_NOSIGNAL)<0) throw FileOperationException("Cannot talk to "+socketPath);
+    while(reply.find('\n')==string::npos){
+        ssize_t n=recv(clients[0].fd,buf,sizeof(buf),0);
+        if(n<=0) throw FileOperationException("Server closed the connection");
+        reply.append(buf,(size_t)n);
+    }
+    long products=0, nextId=0;
+    if(sscanf(reply.c_str(),"OK %ld %ld",&products,&nextId)!=2||products<1) throw FileOperationException("Server has no products");
+    int firstId=(int)max(1L,nextId-products), lastId=(int)nextId-1;
+    const char* words[]={"milk","bread","apple","süd","çörək","cheese","pendir","juice","tea","coffee"};
+    mt19937 rng(21);
+    uniform_int_distribution<int> pickId(firstId,lastId), pickMix(0,99), pickQty(1,3), pickLines(1,5), pickWord(0,9);
+    auto nextRequest=[&](string& out){
+        int mix=pickMix(rng);
+        if(mix<70){ out+="FIND "; out+=to_string(pickId(rng)); }
+        else if(mix<90){
+            out+="SALE 1";
+            for(int i=pickLines(rng);i>0;i--){ out+=' '; out+=to_string(pickId(rng)); out+=':'; out+=to_string(pickQty(rng)); }
+        } else{ out+="SEARCH 5 "; out+=words[pickWord(rng)]; }
+        out+='\n';
+    };
+    auto flush=[](Client& c){
+        size_t done=0;
+        while(done<c.out.size()){
+            ssize_t n=send(c.fd,c.out.data()+done,c.out.size()-done,MSG_NOSIGNAL);
+            if(n<0){ if(errno==EINTR) continue; if(errno==EAGAIN) break; throw FileOperationException("Server went away"); }
+            done+=(size_t)n;
+        }
+        c.out.erase(0,done);
+    };
+    for(auto& c:clients){
+        fcntl(c.fd,F_SETFL,fcntl(c.fd,F_GETFL)|O_NONBLOCK);
+        epoll_event ev{};
+        ev.events=EPOLLIN;
+        ev.data.ptr=&c;
+        epoll_ctl(epfd,EPOLL_CTL_ADD,c.fd,&ev);
+        auto now=chrono::steady_clock::now();
+        for(int i=0;i<max(1,pipeline);i++){ nextRequest(c.out); c.sent.push_back(now); }
+        flush(c);
+    }
+    vector<double> latencies;
+    latencies.reserve(1<<20);
+    size_t errors=0;
+    auto start=chrono::steady_clock::now(), stop=start+chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+    epoll_event events[256];
+    while(chrono::steady_clock::now()<stop){
+        int n=epoll_wait(epfd,events,256,100);
+        for(int i=0;i<n;i++){
+            Client& c=*(Client*)events[i].data.ptr;
+            while(true){
+                ssize_t got=recv(c.fd,buf,sizeof(buf),0);
+                if(got>0){ c.in.append(buf,(size_t)got); continue; }
+                if(got==0) throw FileOperationException("Server closed the connection");
+                if(errno==EINTR) continue;
+                break;
+            }
+            auto now=chrono::steady_clock::now();
+            size_t pos=0, eol;
+            while((eol=c.in.find('\n',pos))!=string::npos&&!c.sent.empty()){
+                if(c.in.compare(pos,3,"ERR")==0) errors++;
+                latencies.push_back(chrono::duration<double,micro>(now-c.sent.front()).count());
+                c.sent.pop_front();
+                pos=eol+1;
+                if(now<stop){ nextRequest(c.out); c.sent.push_back(now); }
+            }
+            c.in.erase(0,pos);
+            flush(c);
+        }
+    }
+    double elapsed=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    for(auto& c:clients) close(c.fd);
+    close(epfd);
+    sort(latencies.begin(),latencies.end());
+    auto pct=[&latencies](double q){ return latencies.empty()?0:latencies[(size_t)(q*(latencies.size()-1))]; };
+    cout << "\n" << BOLD << BG_BLUE << WHITE << "           LOAD GENERATOR REPORT           " << RESET << "\n";
+    cout << CYAN << "Connections: " << RESET << clients.size() << CYAN << ", pipeline depth: " << RESET << pipeline
+         << CYAN << ", requests: " << RESET << latencies.size() << CYAN << " (" << RESET << (errors?RED:GREEN) << errors
+         << RESET << CYAN << " errors)" << RESET << "\n";
+    cout << CYAN << "Throughput: " << RESET << BRIGHT_GREEN << fixed << setprecision(0)
+         << (elapsed>0?latencies.size()/elapsed:0) << RESET << " requests/s over " << setprecision(2) << elapsed << "s\n";
+    cout << CYAN << "Latency (us): " << RESET << "p50=" << pct(0.50) << " p90=" << pct(0.90) << " p99=" << pct(0.99)
+         << " p99.9=" << pct(0.999) << " max=" << (latencies.empty()?0:latencies.back()) << "\n";
+}
+
+void printUsage(const char* prog){
+    cout << "Usage:\n"
+         << "  " << prog << "                                   interactive menu\n"
+         << "  " << prog << " --batch <log> [catalog.csv] [lanes] [receiptDir]  replay a transaction log\n"
+         << "  " << prog << " --bench-lanes <log> <catalog.csv> [maxLanes]  checkout scaling by lane count\n"
+         << "  " << prog << " --gen-batch <catalog.csv> <log> <products> <baskets> [items]\n"
+         << "  " << prog << " --labels <catalog.csv> <dir>      render every product label\n"
+         << "  " << prog << " --verify-labels <catalog.csv> <dir> [threads]  decode labels against the catalog\n"
+         << "  " << prog << " --bench-recovery <catalog.csv> <dir> [baskets]  snapshot + log restart time\n"
+         << "  " << prog << " --bench-payroll [employees]       virtual vs columnar payroll\n"
+         << "  " << prog << " --bench-analytics [products] [maxBaskets]  report latency vs history size\n"
+         << "  " << prog << " --bench-lookup [maxProducts]      map vs flat store lookup latency\n"
+         << "  " << prog << " --bench-memory [products]         resident size of the product layouts\n"
+         << "  " << prog << " --bench-lowstock [maxProducts]    reorder listing vs catalog scan\n"
+         << "  " << prog << " --bench-snapshot [products] [seconds]  checkout latency during a catalog export\n"
+         << "  " << prog << " --bench-pricing [promotions] [items]  promotion pricing per basket\n"
+         << "  " << prog << " --bench-search [maxProducts]      name search latency\n"
+         << "  " << prog << " --view <products|employees|transactions> [--data dir|--catalog csv] [--sort key] [--desc]\n"
+         << "        [--category name] [--cashier id] [--from date] [--to date] [--page n] [--page-size n] [--all]\n"
+         << "        [--plain|--table]                  one page of a listing; plain is tab-separated\n"
+         << "  " << prog << " --export-sales <dataDir> <file.stxc|file.csv> [from] [to]  sold lines, columnar or CSV\n"
+         << "  " << prog << " --scan-sales <file.stxc> [from] [to]  totals and top products from an export\n"
+         << "  " << prog << " --bench-columnar [baskets]        columnar vs CSV size and scan time\n"
+         << "  " << prog << " --chain <storesDir> [sku] [threads]  load every store (CSV or data dir), chain report\n"
+         << "  " << prog << " --bench-chain [stores] [productsPerStore] [basketsPerStore]  chain scaling\n"
+         << "  " << prog << " --serve <socket> [catalog.csv] [dataDir] [threads]  headless POS server\n"
+         << "  " << prog << " --loadgen <socket> [connections] [seconds] [pipeline]  drive a server\n";
+}
+
+int runCommandLine(int argc,char* argv[]){
+    string mode=argv[1];
+    try{
+        if(mode=="--batch"&&argc>=3){
+            SupermarketManager manager;
+            if(argc>=4) manager.loadProductsFromFile(argv[3]);
+            else{
+                manager.addProduct("Milk",3.99,50,"Dairy");
+                manager.addProduct("Bread",2.49,100,"Bakery");
+                manager.addProduct("Apple",1.99,200,"Fruits");
+            }
+            manager.addCashier("Batch Cashier","000-000-00-00",2000);
+            if(argc>=6) manager.attachReceipts(argv[5]);
+            BatchReplayer replayer(manager);
+            replayer.replayFile(argv[2],argc>=5?stoi(argv[4]):1);
+            auto start=chrono::steady_clock::now();
+            manager.flushStorage();
+            if(argc>=6)
+                cout << CYAN << "Receipt archive drained " << RESET << fixed << setprecision(3)
+                     << chrono::duration<double>(chrono::steady_clock::now()-start).count() << "s after the last checkout\n";
+            Stats::display(Stats::snapshot());
+            return 0;
+        }
+        if(mode=="--bench-lanes"&&argc>=4){
+            int maxLanes=argc>=5?stoi(argv[4]):(int)max(1u,thread::hardware_concurrency());
+            double base=0;
+            for(int lanes=1;lanes<=maxLanes;lanes*=2){
+                SupermarketManager manager;
+                manager.loadProductsFromFile(argv[3]);
+                manager.addCashier("Batch Cashier","000-000-00-00",2000);
+                BatchReplayer replayer(manager);
+                double rate=replayer.replayFile(argv[2],lanes);
+                if(lanes==1) base=rate;
+                cout << BRIGHT_CYAN << "Speedup vs 1 lane: " << RESET << fixed << setprecision(2)
+                     << (base>0?rate/base:0) << "x\n";
+            }
+            return 0;
+        }
+        if(mode=="--labels"&&argc>=4){
+            SupermarketManager manager;
+            manager.loadProductsFromFile(argv[2]);
+            manager.generateAllBarcodes(argv[3]);
+            return 0;
+        }
+        if(mode=="--verify-labels"&&argc>=4){
+            SupermarketManager manager;
+            manager.loadProductsFromFile(argv[2]);
+            manager.verifyLabels(argv[3],argc>=5?stoi(argv[4]):0);
+            return 0;
+        }
+        if(mode=="--bench-recovery"&&argc>=4){
+            runRecoveryBenchmark(argv[2],argv[3],argc>=5?stol(argv[4]):100000);
+            return 0;
+        }
+        if(mode=="--bench-payroll"){
+            runPayrollBenchmark(argc>=3?stoi(argv[2]):100000);
+            return 0;
+        }
+        if(mode=="--bench-analytics"){
+            runAnalyticsBenchmark(argc>=3?stoi(argv[2]):100000,argc>=4?stol(argv[3]):1000000);
+            return 0;
+        }
+        if(mode=="--bench-pricing"){
+            runPricingBenchmark(argc>=3?stoi(argv[2]):5000,argc>=4?stoi(argv[3]):100);
+            return 0;
+        }
+        if(mode=="--bench-lowstock"){
+            runLowStockBenchmark(argc>=3?stoi(argv[2]):1000000);
+            return 0;
+        }
+        if(mode=="--serve"&&argc>=3){
+            SupermarketManager manager;
+            bool recovered=false;
+            if(argc>=5){
+                recovered=manager.attachStorage(argv[4],false);
+                manager.attachReceipts(string(argv[4])+"/receipts");
+            }
+            bool catalog=argc>=4&&string(argv[3])!="-";
+            if(catalog&&recovered) /* the recovered stock is newer than anything in the catalog */
+                cout << YELLOW << "⚠ Catalog " << argv[3] << " ignored: state recovered from " << argv[4] << RESET << "\n";
+            else if(catalog) manager.loadProductsFromFile(argv[3]);
+            else if(!recovered){
+                manager.addProduct("Milk",3.99,50,"Dairy");
+                manager.addProduct("Bread",2.49,100,"Bakery");
+                manager.addProduct("Apple",1.99,200,"Fruits");
+            }
+            if(!recovered) manager.addCashier("Terminal Cashier","000-000-00-00",2000);
+            PosServer server(manager,argv[2]);
+            server.run(argc>=6?stoi(argv[5]):(int)max(1u,thread::hardware_concurrency()));
+            manager.flushStorage();
+            manager.checkpoint();
+            Stats::display(Stats::snapshot());
+            return 0;
+        }
+        if(mode=="--loadgen"&&argc>=3){
+            runLoadGenerator(argv[2],argc>=4?stoi(argv[3]):32,argc>=5?stod(argv[4]):10,argc>=6?stoi(argv[5]):8);
+            return 0;
+        }
+        if(mode=="--bench-search"){
+            runSearchBenchmark(argc>=3?stoi(argv[2]):1000000);
+            return 0;
+        }
+        if(mode=="--view"&&argc>=3){
+            ViewOptions o;
+            o.plain=!isatty(STDOUT_FILENO);
+            string dir=".", catalog;
+            for(int i=3;i<argc;i++){
+                string option=argv[i];
+                auto value=[&](){
+                    if(i+1>=argc) throw invalid_argument("Missing value for "+option);
+                    return string(argv[++i]);
+                };
+                if(option=="--data") dir=value();
+                else if(option=="--catalog") catalog=value();
+                else if(option=="--sort") o.sortBy=value();
+                else if(option=="--desc") o.descending=true;
+                else if(option=="--category") o.category=value();
+                else if(option=="--cashier") o.cashierId=stoi(value());
+                else if(option=="--from") o.from=parseRangeEnd(value(),false);
+                else if(option=="--to") o.to=parseRangeEnd(value(),true);
+                else if(option=="--page") o.page=(size_t)max(1,stoi(value()))-1;
+                else if(option=="--page-size") o.pageSize=stoul(value());
+                else if(option=="--all") o.pageSize=0;
+                else if(option=="--plain") o.plain=true;
+                else if(option=="--table") o.plain=false;
+                else throw invalid_argument("Unknown option "+option);
+            }
+            SupermarketManager manager;
+            if(catalog.empty()) manager.loadStorage(dir);
+            else{
+                streambuf* console=cout.rdbuf(nullptr); /* keep load messages out of the listing */
+                try{
+                    manager.loadProductsFromFile(catalog);
+                } catch(...){
+                    cout.rdbuf(console);
+                    throw;
+                }
+                cout.rdbuf(console);
+            }
+            manager.printView(argv[2],o);
+            return 0;
+        }
+        if(mode=="--export-sales"&&argc>=4){
+            int64_t range[2]={INT64_MIN,INT64_MAX};
+            for(int i=4;i<argc&&i<6;i++) range[i-4]=parseRangeEnd(argv[i],i==5);
+            SupermarketManager manager;
+            manager.loadStorage(argv[2]);
+            manager.exportSales(argv[3],range[0],range[1]);
+            return 0;
+        }
+        if(mode=="--scan-sales"&&argc>=3){
+            int64_t range[2]={INT64_MIN,INT64_MAX};
+            for(int i=3;i<argc&&i<5;i++) range[i-3]=parseRangeEnd(argv[i],i==4);
+            printSalesSummary(argv[2],range[0],range[1]);
+            return 0;
+        }
+        if(mode=="--bench-columnar"){
+            runColumnarBenchmark(argc>=3?stol(argv[2]):1000000);
+            return 0;
+        }
+        if(mode=="--chain"&&argc>=3){
+            StoreChain chain(argc>=5?stoi(argv[4]):0);
+            vector<string> sources=StoreChain::findSources(argv[2]);
+            if(sources.empty()) throw FileOperationException(string("No store catalogs or data directories in ")+argv[2]);
+            auto start=chrono::steady_clock::now();
+            chain.load(sources);
+            cout << BRIGHT_GREEN << "✓ Loaded " << chain.size() << " stores in " << RESET << fixed << setprecision(3)
+                 << chrono::duration<double>(chrono::steady_clock::now()-start).count() << "s on "
+                 << min<size_t>(chain.getWorkers(),chain.size()) << " thread(s)" << endl;
+            chain.report(argc>=4?stoi(argv[3]):-1);
+            return 0;
+        }
+        if(mode=="--bench-chain"){
+            runChainBenchmark(argc>=3?stoi(argv[2]):8,argc>=4?stoul(argv[3]):100000,argc>=5?stol(argv[4]):20000);
+            return 0;
+        }
+        if(mode=="--bench-snapshot"){
+            runSnapshotBenchmark(argc>=3?stoi(argv[2]):1000000,argc>=4?stod(argv[3]):2);
+            return 0;
+        }
+        if(mode=="--bench-memory"){
+            runMemoryBenchmark(argc>=3?stoul(argv[2]):10000000);
+            return 0;
+        }
+        if(mode=="--bench-lookup"){
+            runLookupBenchmark(argc>=3?stoul(argv[2]):1000000);
+            return 0;
+        }
+        if(mode=="--gen-batch"&&argc>=6){
+            generateBatchInput(argv[2],argv[3],stoi(argv[4]),stol(argv[5]),argc>=7?stoi(argv[6]):10);
+            return 0;
+        }
+    } catch(const exception& e){
+        cout << RED << "✗ ERROR: " << e.what() << RESET << endl;
+        return 1;
+    }
+    printUsage(argv[0]);
+    return 1;
+}
+
+/* STOX_bench.cpp includes this file with STOX_NO_MAIN and brings its own main */
+#ifndef STOX_NO_MAIN
+int main(int argc,char* argv[]){
+    StatClock::start();
+    if(argc>1) return runCommandLine(argc,argv);
+    StatsReporter statsReporter("stox_stats.csv",10);
     SupermarketManager manager;
     int choice;
     cout << "\n" << BOLD << BG_GREEN;
@@ -479,21 +5928,38 @@ int main(){
     cout << "║   ███████║   ██║   ╚██████╔╝██╔╝ ██╗  ║\n";
     cout << "║   ╚══════╝   ╚═╝    ╚═════╝ ╚═╝  ╚═╝  ║\n";
     cout << "╚═══════════════════════════════════════╝" << RESET << "\n\n";
-    cout << GREEN << "\nLoading Initializing system with sample data..." << RESET << "\n";
+    bool recovered=false;
     try{
-        manager.addProduct("Milk",3.99,50,"Dairy");
-        manager.addProduct("Bread",2.49,100,"Bakery");
-        manager.addProduct("Apple",1.99,200,"Fruits");
-        manager.addCashier("Kamal Surxanlı","077-543-55-21",2000);
-        manager.addManager("Müseyib Teymurov","099-805-49-22",5000,1000);
-        cout << BRIGHT_GREEN << "✓ System initialized successfully!\n" << RESET;
+        recovered=manager.attachStorage(".");
     } catch(const exception& e){
-        cout << RED << "✗ Error during initialization: " << e.what() << RESET << endl;
+        cout << RED << "✗ Storage unavailable, running without persistence: " << e.what() << RESET << endl;
+    }
+    try{
+        manager.attachReceipts("receipts");
+    } catch(const exception& e){
+        cout << RED << "✗ Receipt archive unavailable: " << e.what() << RESET << endl;
+    }
+    if(!recovered){
+        cout << GREEN << "\nLoading Initializing system with sample data..." << RESET << "\n";
+        try{
+            manager.addProduct("Milk",3.99,50,"Dairy");
+            manager.addProduct("Bread",2.49,100,"Bakery");
+            manager.addProduct("Apple",1.99,200,"Fruits");
+            manager.addCashier("Kamal Surxanlı","077-543-55-21",2000);
+            manager.addManager("Müseyib Teymurov","099-805-49-22",5000,1000);
+            cout << BRIGHT_GREEN << "✓ System initialized successfully!\n" << RESET;
+        } catch(const exception& e){
+            cout << RED << "✗ Error during initialization: " << e.what() << RESET << endl;
+        }
     }
     
     while(true){
         displayMenu();
         cin>>choice;
+        if(cin.eof()){
+            manager.checkpoint();
+            return 0;
+        }
         if(cin.fail()){
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -555,7 +6021,96 @@ int main(){
                 case 10: manager.saveProductsToFile("products.csv"); break;
                 case 11: manager.loadProductsFromFile("products.csv"); break;
                 case 12: manager.saveEmployeesToFile("employees.csv"); break;
+                case 13: manager.generateAllBarcodes("labels"); break;
+                case 14: manager.checkpoint(); break;
+                case 16: manager.runPayroll(); break;
+                case 21: Stats::display(Stats::snapshot()); break;
+                case 22: manager.verifyLabels("labels"); break;
+                case 23: manager.exportSales("sales.stxc"); break;
+                case 20:{
+                    string query;
+                    cout << YELLOW << "Name or category: " << RESET; cin.ignore(); getline(cin,query);
+                    manager.showSearch(query);
+                    break;
+                }
+                case 17: manager.showSalesReport(); break;
+                case 19:{
+                    manager.displayPromotions();
+                    int action;
+                    cout << YELLOW << "\n1) Buy X get Y 2) Category % off 3) Bundle price 4) Remove 0) Back: " << RESET;
+                    cin>>action;
+                    PricingEngine::Rule rule;
+                    if(action==1){
+                        rule.kind=PricingEngine::MULTI_BUY;
+                        cout << YELLOW << "Product ID: " << RESET; cin>>rule.productId;
+                        cout << YELLOW << "Buy: " << RESET; cin>>rule.buy;
+                        cout << YELLOW << "Get free: " << RESET; cin>>rule.get;
+                        manager.addPromotion(rule);
+                    } else if(action==2){
+                        double percent;
+                        rule.kind=PricingEngine::CATEGORY_PERCENT;
+                        cout << YELLOW << "Category: " << RESET; cin.ignore(); getline(cin,rule.category);
+                        cout << YELLOW << "Percent off: " << RESET; cin>>percent;
+                        rule.basisPoints=(int)llround(percent*100);
+                        manager.addPromotion(rule);
+                    } else if(action==3){
+                        string ids; double price;
+                        rule.kind=PricingEngine::BUNDLE;
+                        cout << YELLOW << "Product IDs (space separated): " << RESET; cin.ignore(); getline(cin,ids);
+                        cout << YELLOW << "Bundle price: " << RESET; cin>>price;
+                        stringstream list(ids);
+                        int id;
+                        while(list>>id) rule.products.push_back(id);
+                        rule.bundlePrice=toCents(price);
+                        manager.addPromotion(rule);
+                    } else if(action==4){
+                        int id;
+                        cout << YELLOW << "Promotion ID: " << RESET; cin>>id;
+                        manager.removePromotion(id);
+                    }
+                    break;
+                }
+                case 18:{
+                    manager.showLowStock();
+                    int action;
+                    cout << YELLOW << "\n1) Export reorder.csv 2) Product threshold 3) Category threshold 0) Back: " << RESET;
+                    cin>>action;
+                    if(action==1) manager.exportReorderList("reorder.csv");
+                    else if(action==2){
+                        int id,value;
+                        cout << YELLOW << "Product ID: " << RESET; cin>>id;
+                        cout << YELLOW << "Reorder below: " << RESET; cin>>value;
+                        manager.setReorderThreshold(id,value);
+                    } else if(action==3){
+                        string category; int value;
+                        cout << YELLOW << "Category: " << RESET; cin.ignore(); getline(cin,category);
+                        cout << YELLOW << "Reorder below: " << RESET; cin>>value;
+                        manager.setCategoryReorderThreshold(category,value);
+                    }
+                    break;
+                }
+                case 15:{
+                    int mode;
+                    cout << YELLOW << "Search by 1) ID range 2) Cashier 3) Date range: " << RESET; cin>>mode;
+                    if(mode==1){
+                        int from,to;
+                        cout << YELLOW << "From ID: " << RESET; cin>>from;
+                        cout << YELLOW << "To ID: " << RESET; cin>>to;
+                        manager.searchTransactions(1,from,to);
+                    } else if(mode==2){
+                        int cashierId;
+                        cout << YELLOW << "Cashier ID: " << RESET; cin>>cashierId;
+                        manager.searchTransactions(2,cashierId,0);
+                    } else if(mode==3){
+                        string from,to;
+                        cout << YELLOW << "From (YYYY-MM-DD [HH:MM]): " << RESET; cin.ignore(); getline(cin,from);
+                        cout << YELLOW << "To (YYYY-MM-DD [HH:MM]): " << RESET; getline(cin,to);
+                        manager.searchTransactions(3,parseRangeEnd(from,false),parseRangeEnd(to,true));
+                    } else cout << RED << "✗ Invalid search type!" << RESET << "\n";
+                    break;
+                }
                 case 0: 
+                    manager.checkpoint();
                     cout << "\n" << MAGENTA << "✓ Thank you for using STOX system! Goodbye!" << RESET << "\n\n"; 
                     return 0;
                 default: 
@@ -568,3 +6123,4 @@ int main(){
     }
     return 0;
 }
+#endif
@@ -0,0 +1,369 @@
+/* Benchmark suite for STOX. Builds a synthetic store (N products, M employees, K baskets whose
+   products follow a Zipf distribution), times the hot operations and prints the results as JSON.
+
+       g++ -std=c++17 -O2 -pthread STOX_bench.cpp -o STOX_bench
+       ./STOX_bench --products 100000 --baskets 100000 > bench.json
+       ./STOX_bench --compare bench.json      exits 1 when an operation got slower than --threshold */
+#define STOX_NO_MAIN
+#include "STOX.cpp"
+
+/* discards the progress lines the manager prints while the suite runs */
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c){ return c; }
+};
+
+struct BenchConfig {
+    int products, employees, itemsPerBasket, repetitions, labels;
+    long baskets;
+    double zipf;
+    unsigned seed;
+    string dir;
+    BenchConfig() : products(100000), employees(100), itemsPerBasket(10), repetitions(5), labels(2000),
+                    baskets(100000), zipf(1.0), seed(42), dir("bench_data") {}
+};
+
+/* rank r (0-based) is drawn with probability proportional to 1/(r+1)^s */
+class ZipfSampler {
+private:
+    vector<double> cdf;
+public:
+    ZipfSampler(int n,double s) : cdf(n) {
+        double sum=0;
+        for(int r=0;r<n;r++){ sum+=1.0/pow(r+1.0,s); cdf[r]=sum; }
+        for(auto& c:cdf) c/=sum;
+    }
+    template<typename Rng>
+    int operator()(Rng& rng){
+        double u=uniform_real_distribution<double>(0,1)(rng);
+        return (int)min<size_t>(upper_bound(cdf.begin(),cdf.end(),u)-cdf.begin(),cdf.size()-1);
+    }
+};
+
+/* the same seed always yields the same catalog, staff and baskets */
+class SyntheticStore {
+public:
+    struct Item { string name, category; double price; };
+    vector<Item> catalog;
+    vector<int> cashiers;
+    vector<vector<pair<int,int>>> baskets;
+    SyntheticStore(const BenchConfig& config){
+        const char* brands[]={"Atena","Milla","Sevimli","Gilan","Gənclik","Sirab","Azərçay","Ulduz","Dadlı","Bərəkət"};
+        const char* goods[]={"Süd","Çörək","Şəkər","Yağ","Pendir","Qatıq","Alma","Çay","Qəhvə","Düyü","Bal","Su",
+                             "Milk","Bread","Cheese","Butter","Yogurt","Coffee","Rice","Juice"};
+        const char* sizes[]={"250g","500g","1kg","0.5l","1l","2l"};
+        mt19937 rng(config.seed);
+        catalog.reserve(config.products);
+        for(int i=0;i<config.products;i++){
+            Item item;
+            item.name=string(brands[rng()%10])+" "+goods[rng()%20]+" "+sizes[rng()%6];
+            item.category="Category"+to_string(i%50);
+            item.price=(99+rng()%4900)/100.0;
+            catalog.push_back(item);
+        }
+        /* popularity rank is shuffled over ids so best sellers are spread through the catalog */
+        vector<int> byRank(config.products);
+        for(int i=0;i<config.products;i++) byRank[i]=1001+i;
+        shuffle(byRank.begin(),byRank.end(),rng);
+        ZipfSampler pick(config.products,config.zipf);
+        for(int i=0;i<config.employees;i++) if(i%10!=9) cashiers.push_back(i+1);
+        if(cashiers.empty()) cashiers.push_back(1);
+        baskets.resize(config.baskets);
+        for(auto& basket:baskets){
+            basket.resize(config.itemsPerBasket);
+            for(auto& item:basket) item=make_pair(byRank[pick(rng)],1+(int)(rng()%3));
+        }
+    }
+    int cashierFor(size_t basket) const { return cashiers[basket%cashiers.size()]; }
+    /* employees get ids 1..M in order, so cashierFor() names real cashiers */
+    void populate(SupermarketManager& manager,const BenchConfig& config) const {
+        for(auto& item:catalog) manager.addProductQuiet(item.name,item.price,1000000000,item.category);
+        for(int i=0;i<config.employees;i++){
+            if(i%10!=9) manager.addCashier("Cashier"+to_string(i+1),"000-000-00-00",2000);
+            else manager.addManager("Manager"+to_string(i+1),"000-000-00-00",5000,1000);
+        }
+    }
+    /* catalog CSV plus a basket log in the --batch format */
+    void write(const string& dir) const {
+        filesystem::create_directories(dir);
+        ofstream csv(dir+"/catalog.csv");
+        if(!csv) throw FileOperationException("Cannot open "+dir+"/catalog.csv");
+        csv<<"ProductID,Name,Price,Stock,Category\n";
+        for(size_t i=0;i<catalog.size();i++)
+            csv<<1001+i<<","<<csvField(catalog[i].name)<<","<<formatCents(toCents(catalog[i].price))<<",1000000000,"
+               <<csvField(catalog[i].category)<<"\n";
+        ofstream log(dir+"/baskets.log");
+        if(!log) throw FileOperationException("Cannot open "+dir+"/baskets.log");
+        for(size_t b=0;b<baskets.size();b++){
+            log<<cashierFor(b);
+            for(auto& item:baskets[b]) log<<' '<<item.first<<':'<<item.second;
+            log<<'\n';
+        }
+    }
+};
+
+struct BenchResult {
+    string name;
+    size_t ops;
+    double medianNs, minNs, maxNs, opsPerSecond;
+    uint64_t bytes;
+};
+
+class BenchSuite {
+private:
+    const BenchConfig& config;
+    const SyntheticStore& store;
+    vector<BenchResult> results;
+    typedef chrono::steady_clock Clock;
+    static double nanos(Clock::time_point from){ return chrono::duration<double,nano>(Clock::now()-from).count(); }
+    /* body(rep) returns the nanoseconds of its timed section; setup it does outside that is not counted */
+    template<typename F>
+    void measure(const string& name,size_t ops,F body,uint64_t bytes=0){
+        vector<double> perOp;
+        for(int rep=0;rep<config.repetitions;rep++) perOp.push_back(body(rep)/max<size_t>(ops,1));
+        sort(perOp.begin(),perOp.end());
+        double median=perOp[perOp.size()/2];
+        results.push_back(BenchResult{name,ops,median,perOp.front(),perOp.back(),median>0?1e9/median:0,bytes});
+        cerr << left << setw(24) << name << fixed << setprecision(1) << setw(14) << median << " ns/op\n";
+    }
+    static uint64_t directoryBytes(const string& dir){
+        uint64_t total=0;
+        for(auto& entry:filesystem::directory_iterator(dir)) if(entry.is_regular_file()) total+=entry.file_size();
+        return total;
+    }
+public:
+    BenchSuite(const BenchConfig& c,const SyntheticStore& s) : config(c), store(s) {}
+    void run(){
+        filesystem::create_directories(config.dir);
+        size_t n=store.catalog.size();
+        measure("add_product",n,[this](int){
+            SupermarketManager manager;
+            auto t0=Clock::now();
+            for(auto& item:store.catalog) manager.addProductQuiet(item.name,item.price,1000000000,item.category);
+            return nanos(t0);
+        });
+        SupermarketManager manager;
+        store.populate(manager,config);
+        vector<int> ids;
+        for(auto& basket:store.baskets) for(auto& item:basket) ids.push_back(item.first);
+        measure("lookup_id",ids.size(),[&](int){
+            long sum=0;
+            auto t0=Clock::now();
+            for(int id:ids) if(Product* p=manager.findProduct(id)) sum+=p->getStock();
+            double ns=nanos(t0);
+            benchmarkSink+=sum;
+            return ns;
+        });
+        vector<string> barcodes;
+        for(size_t i=0;i<ids.size()&&i<1000000;i++) barcodes.push_back("PRD"+to_string(ids[i]));
+        measure("lookup_barcode",barcodes.size(),[&](int){
+            long sum=0;
+            auto t0=Clock::now();
+            for(auto& code:barcodes) if(Product* p=manager.findProductByBarcode(code)) sum+=p->getStock();
+            double ns=nanos(t0);
+            benchmarkSink+=sum;
+            return ns;
+        });
+        measure("transaction_add_item",ids.size(),[&](int){
+            Transaction trans;
+            auto t0=Clock::now();
+            for(size_t b=0;b<store.baskets.size();b++){
+                trans.reset(store.cashierFor(b),&manager);
+                for(auto& item:store.baskets[b]) trans.addItem(manager.findProduct(item.first),item.second);
+            }
+            return nanos(t0);
+        });
+        measure("checkout",store.baskets.size(),[&](int){
+            auto t0=Clock::now();
+            for(size_t b=0;b<store.baskets.size();b++) manager.checkout(store.cashierFor(b),store.baskets[b]);
+            return nanos(t0);
+        });
+        runReceipts();
+        runBarcodes(manager);
+        string csv=config.dir+"/products.csv";
+        measure("save_products",n,[&](int){
+            auto t0=Clock::now();
+            manager.saveProductsToFile(csv);
+            return nanos(t0);
+        });
+        results.back().bytes=filesystem::file_size(csv);
+        measure("load_products",n,[&](int){
+            SupermarketManager fresh;
+            auto t0=Clock::now();
+            fresh.loadProductsFromFile(csv);
+            return nanos(t0);
+        },filesystem::file_size(csv));
+    }
+    /* formats and archives one receipt per basket through ReceiptWriter, queue to disk */
+    void runReceipts(){
+        ProductStore products;
+        products.reserve(store.catalog.size());
+        for(size_t i=0;i<store.catalog.size();i++){
+            auto& item=store.catalog[i];
+            products.insert(Product(1001+(int)i,item.name,item.price,1000000000,item.category));
+        }
+        TransactionJournal journal;
+        vector<const TransactionRecord*> records;
+        vector<LineItem> lines;
+        for(size_t b=0;b<store.baskets.size();b++){
+            lines.clear();
+            Cents total=0;
+            for(auto& item:store.baskets[b]){
+                Cents unit=products.find(item.first)->getPriceCents();
+                lines.push_back(LineItem{item.first,item.second,unit,0});
+                total+=unit*item.second;
+            }
+            records.push_back(&journal.append((int)b,store.cashierFor(b),lines,total));
+        }
+        string dir=config.dir+"/receipts";
+        uint64_t bytes=0;
+        measure("generate_receipt",records.size(),[&](int){
+            filesystem::remove_all(dir);
+            ReceiptWriter writer(journal,products,dir);
+            auto t0=Clock::now();
+            for(auto rec:records) writer.enqueue(*rec);
+            writer.flush();
+            double ns=nanos(t0);
+            bytes=directoryBytes(dir);
+            return ns;
+        });
+        results.back().bytes=bytes;
+    }
+    void runBarcodes(SupermarketManager& manager){
+        size_t count=min<size_t>(config.labels,store.catalog.size());
+        string dir=config.dir+"/labels";
+        filesystem::create_directories(dir);
+        measure("generate_barcode",count,[&](int){
+            auto t0=Clock::now();
+            for(size_t i=0;i<count;i++){
+                Product* p=manager.findProduct(1001+(int)i);
+                p->generateBarcode(dir+"/"+p->getBarcode()+".pbm");
+            }
+            return nanos(t0);
+        });
+        results.back().bytes=directoryBytes(dir);
+    }
+    void writeJson(ostream& out) const {
+        out << "{\n  \"suite\": \"stox-bench\",\n  \"format\": 1,\n  \"config\": {"
+            << "\"products\": " << config.products << ", \"employees\": " << config.employees
+            << ", \"baskets\": " << config.baskets << ", \"itemsPerBasket\": " << config.itemsPerBasket
+            << ", \"zipf\": " << config.zipf << ", \"seed\": " << config.seed
+            << ", \"repetitions\": " << config.repetitions << ", \"threads\": " << thread::hardware_concurrency() << "},\n"
+            << "  \"results\": [\n";
+        for(size_t i=0;i<results.size();i++){
+            const BenchResult& r=results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops << fixed << setprecision(2)
+                << ", \"median_ns_per_op\": " << r.medianNs << ", \"min_ns_per_op\": " << r.minNs
+                << ", \"max_ns_per_op\": " << r.maxNs << ", \"ops_per_sec\": " << setprecision(0) << r.opsPerSecond
+                << ", \"bytes\": " << r.bytes << "}" << (i+1<results.size()?",":"") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+    /* reads median_ns_per_op back out of a previous run's JSON */
+    static map<string,double> readBaseline(const string& filename){
+        ifstream in(filename);
+        if(!in) throw FileOperationException("Cannot open "+filename);
+        string text((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+        map<string,double> medians;
+        size_t pos=0;
+        while((pos=text.find("\"name\": \"",pos))!=string::npos){
+            pos+=9;
+            size_t end=text.find('"',pos);
+            size_t value=text.find("\"median_ns_per_op\": ",end);
+            if(end==string::npos||value==string::npos) break;
+            medians[text.substr(pos,end-pos)]=atof(text.c_str()+value+20);
+            pos=end;
+        }
+        return medians;
+    }
+    /* lists every operation against the baseline; returns how many slowed down by more than threshold percent */
+    int compare(const map<string,double>& baseline,double threshold) const {
+        int regressions=0;
+        cerr << "\n" << left << setw(24) << "operation" << setw(14) << "baseline ns" << setw(14) << "now ns" << "change\n";
+        for(auto& r:results){
+            auto it=baseline.find(r.name);
+            if(it==baseline.end()||it->second<=0) continue;
+            double change=(r.medianNs/it->second-1)*100;
+            bool slower=change>threshold;
+            regressions+=slower;
+            cerr << left << setw(24) << r.name << fixed << setprecision(1) << setw(14) << it->second << setw(14) << r.medianNs
+                 << (slower?RED:"") << showpos << change << "%" << noshowpos << (slower?RESET:"") << "\n";
+        }
+        return regressions;
+    }
+};
+
+void printBenchUsage(const char* prog){
+    cerr << "Usage: " << prog << " [options]\n"
+         << "  --products N      catalog size (100000)\n"
+         << "  --employees M     staff, every tenth a manager (100)\n"
+         << "  --baskets K       baskets to ring up (100000)\n"
+         << "  --items I         lines per basket (10)\n"
+         << "  --zipf S          product popularity exponent (1.0)\n"
+         << "  --seed X          generator seed (42)\n"
+         << "  --reps R          repetitions per benchmark, the median is reported (5)\n"
+         << "  --labels L        barcode files per repetition (2000)\n"
+         << "  --dir D           scratch directory (bench_data)\n"
+         << "  --json FILE       write the results there instead of stdout\n"
+         << "  --compare FILE    compare against an earlier JSON result\n"
+         << "  --threshold P     percent slowdown that counts as a regression (10)\n"
+         << "  --generate D      only write D/catalog.csv and D/baskets.log (for STOX --batch)\n";
+}
+
+int main(int argc,char* argv[]){
+    BenchConfig config;
+    string jsonFile, baselineFile, generateDir;
+    double threshold=10;
+    try{
+        for(int i=1;i<argc;i++){
+            string flag=argv[i];
+            if(flag=="--help"){ printBenchUsage(argv[0]); return 0; }
+            if(i+1>=argc){ printBenchUsage(argv[0]); return 1; }
+            string value=argv[++i];
+            if(flag=="--products") config.products=stoi(value);
+            else if(flag=="--employees") config.employees=stoi(value);
+            else if(flag=="--baskets") config.baskets=stol(value);
+            else if(flag=="--items") config.itemsPerBasket=stoi(value);
+            else if(flag=="--zipf") config.zipf=stod(value);
+            else if(flag=="--seed") config.seed=(unsigned)stoul(value);
+            else if(flag=="--reps") config.repetitions=max(1,stoi(value));
+            else if(flag=="--labels") config.labels=stoi(value);
+            else if(flag=="--dir") config.dir=value;
+            else if(flag=="--json") jsonFile=value;
+            else if(flag=="--compare") baselineFile=value;
+            else if(flag=="--threshold") threshold=stod(value);
+            else if(flag=="--generate") generateDir=value;
+            else{ printBenchUsage(argv[0]); return 1; }
+        }
+        if(config.products<1||config.baskets<1||config.itemsPerBasket<1){ printBenchUsage(argv[0]); return 1; }
+        SyntheticStore store(config);
+        if(!generateDir.empty()){
+            store.write(generateDir);
+            cerr << "Wrote " << generateDir << "/catalog.csv and " << generateDir << "/baskets.log\n";
+            return 0;
+        }
+        map<string,double> baseline;
+        if(!baselineFile.empty()) baseline=BenchSuite::readBaseline(baselineFile);
+        NullBuffer discard;
+        streambuf* console=cout.rdbuf(&discard);
+        BenchSuite suite(config,store);
+        try{
+            suite.run();
+        } catch(...){
+            cout.rdbuf(console);
+            throw;
+        }
+        cout.rdbuf(console);
+        if(jsonFile.empty()) suite.writeJson(cout);
+        else{
+            ofstream out(jsonFile);
+            if(!out) throw FileOperationException("Cannot open "+jsonFile);
+            suite.writeJson(out);
+        }
+        if(!baseline.empty()&&suite.compare(baseline,threshold)>0) return 1;
+    } catch(const exception& e){
+        cerr << "ERROR: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}